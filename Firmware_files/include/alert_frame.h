@@ -0,0 +1,206 @@
+#ifndef ALERT_FRAME_H
+#define ALERT_FRAME_H
+
+// Compact binary alert frame shared by the firmware and the server.
+//
+// All multi-byte fields are little-endian and written byte by byte, so the
+// layout does not depend on struct packing or host byte order. Frames are
+// encoded into and decoded from caller-owned buffers; nothing here allocates.
+//
+//  Offset  Size  Field
+//   0       1    magic (0xA5, never a printable character)
+//   1       1    version
+//   2       1    type (ALERT_FRAME_TYPE_*)
+//   3       1    flags (ALERT_FRAME_FLAG_*)
+//   4       6    device ID (station MAC)
+//  10       4    boot ID
+//  14       4    sequence
+//  18       1    alert state (0 = off, 1 = on)
+//  19       1    priority (0 = normal)
+//  20       8    press time in gateway milliseconds (0 = clock not synced)
+//  28       2    battery in millivolts (0 = unknown)
+//  30       1    RSSI in dBm (signed, 0 = unknown)
+//  31       1    length of the TLV area that follows
+//  32       n    optional fields: type (1), length (1), value (length)
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+constexpr uint8_t ALERT_FRAME_MAGIC = 0xA5;
+constexpr uint8_t ALERT_FRAME_VERSION = 1;
+
+constexpr uint8_t ALERT_FRAME_TYPE_ALERT = 1;
+constexpr uint8_t ALERT_FRAME_TYPE_ACK = 2; // Receiver confirms device ID + boot ID + sequence
+
+constexpr uint8_t ALERT_FRAME_FLAG_RETRY = 0x01; // Same sequence was sent before
+
+// TLV types; decoders skip types they do not know
+constexpr uint8_t ALERT_TLV_DEVICE_NAME = 1;
+constexpr uint8_t ALERT_TLV_HOP_COUNT = 2;  // 1 byte, relays so far; absent means 0
+
+constexpr size_t ALERT_FRAME_OFFSET_MAGIC = 0;
+constexpr size_t ALERT_FRAME_OFFSET_VERSION = 1;
+constexpr size_t ALERT_FRAME_OFFSET_TYPE = 2;
+constexpr size_t ALERT_FRAME_OFFSET_FLAGS = 3;
+constexpr size_t ALERT_FRAME_OFFSET_DEVICE_ID = 4;
+constexpr size_t ALERT_FRAME_OFFSET_BOOT_ID = 10;
+constexpr size_t ALERT_FRAME_OFFSET_SEQUENCE = 14;
+constexpr size_t ALERT_FRAME_OFFSET_STATE = 18;
+constexpr size_t ALERT_FRAME_OFFSET_PRIORITY = 19;
+constexpr size_t ALERT_FRAME_OFFSET_PRESS_TIME = 20;
+constexpr size_t ALERT_FRAME_OFFSET_BATTERY = 28;
+constexpr size_t ALERT_FRAME_OFFSET_RSSI = 30;
+constexpr size_t ALERT_FRAME_OFFSET_TLV_LENGTH = 31;
+constexpr size_t ALERT_FRAME_HEADER_SIZE = 32;
+
+constexpr size_t ALERT_FRAME_DEVICE_ID_SIZE = 6;
+constexpr size_t ALERT_FRAME_MAX_TLV = 255;
+constexpr size_t ALERT_FRAME_MAX_SIZE = ALERT_FRAME_HEADER_SIZE + ALERT_FRAME_MAX_TLV;
+
+static_assert(ALERT_FRAME_OFFSET_DEVICE_ID + ALERT_FRAME_DEVICE_ID_SIZE == ALERT_FRAME_OFFSET_BOOT_ID,
+              "device ID overlaps boot ID");
+static_assert(ALERT_FRAME_OFFSET_TLV_LENGTH + 1 == ALERT_FRAME_HEADER_SIZE,
+              "header size does not match the field layout");
+
+struct AlertFrame {
+  uint8_t type = ALERT_FRAME_TYPE_ALERT;
+  uint8_t flags = 0;
+  uint8_t deviceId[ALERT_FRAME_DEVICE_ID_SIZE] = {0};
+  uint32_t bootId = 0;
+  uint32_t sequence = 0;
+  uint8_t state = 0;
+  uint8_t priority = 0;
+  uint64_t pressTimeMs = 0;
+  uint16_t batteryMv = 0;
+  int8_t rssi = 0;
+
+  // Decoded frames point into the receive buffer; encoders fill these via alertFrameAddTlv()
+  const uint8_t* tlv = nullptr;
+  uint8_t tlvLength = 0;
+};
+
+struct AlertTlv {
+  uint8_t type;
+  uint8_t length;
+  const uint8_t* value;
+};
+
+inline void alertFramePut16(uint8_t* p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+inline void alertFramePut32(uint8_t* p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+inline void alertFramePut64(uint8_t* p, uint64_t v) {
+  for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+inline uint16_t alertFrameGet16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+inline uint32_t alertFrameGet32(const uint8_t* p) {
+  uint32_t v = 0;
+  for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+inline uint64_t alertFrameGet64(const uint8_t* p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+  return v;
+}
+
+// Writes the fixed header into out. Returns the header size, or 0 if out is too small.
+// TLVs are appended afterwards with alertFrameAddTlv().
+inline size_t encodeAlertFrame(const AlertFrame& frame, uint8_t* out, size_t cap) {
+  if (cap < ALERT_FRAME_HEADER_SIZE) return 0;
+  out[ALERT_FRAME_OFFSET_MAGIC] = ALERT_FRAME_MAGIC;
+  out[ALERT_FRAME_OFFSET_VERSION] = ALERT_FRAME_VERSION;
+  out[ALERT_FRAME_OFFSET_TYPE] = frame.type;
+  out[ALERT_FRAME_OFFSET_FLAGS] = frame.flags;
+  memcpy(out + ALERT_FRAME_OFFSET_DEVICE_ID, frame.deviceId, ALERT_FRAME_DEVICE_ID_SIZE);
+  alertFramePut32(out + ALERT_FRAME_OFFSET_BOOT_ID, frame.bootId);
+  alertFramePut32(out + ALERT_FRAME_OFFSET_SEQUENCE, frame.sequence);
+  out[ALERT_FRAME_OFFSET_STATE] = frame.state;
+  out[ALERT_FRAME_OFFSET_PRIORITY] = frame.priority;
+  alertFramePut64(out + ALERT_FRAME_OFFSET_PRESS_TIME, frame.pressTimeMs);
+  alertFramePut16(out + ALERT_FRAME_OFFSET_BATTERY, frame.batteryMv);
+  out[ALERT_FRAME_OFFSET_RSSI] = (uint8_t)frame.rssi;
+  out[ALERT_FRAME_OFFSET_TLV_LENGTH] = 0;
+  return ALERT_FRAME_HEADER_SIZE;
+}
+
+// Appends one optional field to a frame produced by encodeAlertFrame().
+// Returns the new frame length, or 0 if the field does not fit (the frame is left unchanged).
+inline size_t alertFrameAddTlv(uint8_t* out, size_t cap, size_t len, uint8_t type,
+                               const void* value, uint8_t valueLength) {
+  size_t tlvLength = out[ALERT_FRAME_OFFSET_TLV_LENGTH];
+  size_t needed = 2 + (size_t)valueLength;
+  if (len + needed > cap || tlvLength + needed > ALERT_FRAME_MAX_TLV) return 0;
+  out[len] = type;
+  out[len + 1] = valueLength;
+  memcpy(out + len + 2, value, valueLength);
+  out[ALERT_FRAME_OFFSET_TLV_LENGTH] = (uint8_t)(tlvLength + needed);
+  return len + needed;
+}
+
+// Parses a received frame. The TLV pointer in frame refers into data, which must outlive it.
+// Rejects wrong magic, newer versions, truncated frames and malformed TLV areas.
+inline bool decodeAlertFrame(const uint8_t* data, size_t len, AlertFrame& frame) {
+  if (len < ALERT_FRAME_HEADER_SIZE) return false;
+  if (data[ALERT_FRAME_OFFSET_MAGIC] != ALERT_FRAME_MAGIC) return false;
+  if (data[ALERT_FRAME_OFFSET_VERSION] == 0 || data[ALERT_FRAME_OFFSET_VERSION] > ALERT_FRAME_VERSION) {
+    return false;
+  }
+
+  uint8_t tlvLength = data[ALERT_FRAME_OFFSET_TLV_LENGTH];
+  if (len < ALERT_FRAME_HEADER_SIZE + tlvLength) return false;
+
+  // Every TLV must end exactly at the end of the TLV area
+  size_t pos = 0;
+  while (pos < tlvLength) {
+    if (pos + 2 > tlvLength) return false;
+    pos += 2 + data[ALERT_FRAME_HEADER_SIZE + pos + 1];
+  }
+  if (pos != tlvLength) return false;
+
+  frame.type = data[ALERT_FRAME_OFFSET_TYPE];
+  frame.flags = data[ALERT_FRAME_OFFSET_FLAGS];
+  memcpy(frame.deviceId, data + ALERT_FRAME_OFFSET_DEVICE_ID, ALERT_FRAME_DEVICE_ID_SIZE);
+  frame.bootId = alertFrameGet32(data + ALERT_FRAME_OFFSET_BOOT_ID);
+  frame.sequence = alertFrameGet32(data + ALERT_FRAME_OFFSET_SEQUENCE);
+  frame.state = data[ALERT_FRAME_OFFSET_STATE];
+  frame.priority = data[ALERT_FRAME_OFFSET_PRIORITY];
+  frame.pressTimeMs = alertFrameGet64(data + ALERT_FRAME_OFFSET_PRESS_TIME);
+  frame.batteryMv = alertFrameGet16(data + ALERT_FRAME_OFFSET_BATTERY);
+  frame.rssi = (int8_t)data[ALERT_FRAME_OFFSET_RSSI];
+  frame.tlv = data + ALERT_FRAME_HEADER_SIZE;
+  frame.tlvLength = tlvLength;
+  return true;
+}
+
+// Iterates the optional fields of a decoded frame; pos starts at 0.
+inline bool alertFrameNextTlv(const AlertFrame& frame, size_t& pos, AlertTlv& tlv) {
+  if (frame.tlv == nullptr || pos + 2 > frame.tlvLength) return false;
+  tlv.type = frame.tlv[pos];
+  tlv.length = frame.tlv[pos + 1];
+  tlv.value = frame.tlv + pos + 2;
+  pos += 2 + tlv.length;
+  return pos <= frame.tlvLength;
+}
+
+// Finds the first optional field of the given type in a decoded frame.
+inline bool alertFrameFindTlv(const AlertFrame& frame, uint8_t type, AlertTlv& tlv) {
+  size_t pos = 0;
+  while (alertFrameNextTlv(frame, pos, tlv)) {
+    if (tlv.type == type) return true;
+  }
+  return false;
+}
+
+#endif // ALERT_FRAME_H
@@ -0,0 +1,67 @@
+#ifndef ALERT_ORIGIN_H
+#define ALERT_ORIGIN_H
+
+// Origin side of the ESP-NOW fallback: this device's own alert frame.
+//
+// The frame stays pending until an ACK for its (device, boot, sequence)
+// comes back, from the bridge or from a relay that posted it, and is re-sent
+// with a doubling backoff meanwhile. A newer press replaces it. As with
+// alert_relay.h, nothing here touches the radio or the clock.
+
+#include "alert_relay.h"
+
+constexpr unsigned long ORIGIN_RETRY_INTERVAL = 250;
+constexpr unsigned long ORIGIN_RETRY_CAP = 5000;
+
+struct OriginAlert {
+  uint8_t frame[ALERT_FRAME_MAX_SIZE];
+  size_t length = 0;
+  uint8_t deviceId[ALERT_FRAME_DEVICE_ID_SIZE] = {};
+  uint32_t bootId = 0;
+  uint32_t sequence = 0;
+  bool pending = false;
+  unsigned long lastSendMs = 0;
+  unsigned long backoffMs = ORIGIN_RETRY_INTERVAL;
+  unsigned long retryDelayMs = ORIGIN_RETRY_INTERVAL; // backoffMs, less any jitter the caller applies
+};
+
+// Makes the encoded alert in data the pending one, sent at nowMs by the caller.
+// Returns false, leaving the state alone, if data is not an alert frame.
+inline bool originStart(OriginAlert& origin, const uint8_t* data, size_t len, unsigned long nowMs) {
+  AlertFrame frame;
+  if (len > sizeof(origin.frame) || !decodeAlertFrame(data, len, frame) ||
+      frame.type != ALERT_FRAME_TYPE_ALERT) return false;
+
+  memcpy(origin.frame, data, len);
+  origin.length = len;
+  memcpy(origin.deviceId, frame.deviceId, sizeof(origin.deviceId));
+  origin.bootId = frame.bootId;
+  origin.sequence = frame.sequence;
+  origin.pending = true;
+  origin.lastSendMs = nowMs;
+  origin.backoffMs = ORIGIN_RETRY_INTERVAL;
+  origin.retryDelayMs = ORIGIN_RETRY_INTERVAL;
+  return true;
+}
+
+// Checks a frame heard over ESP-NOW. True if it ACKs the pending alert, which is then done;
+// ACKs for an older press or another device leave it pending.
+inline bool originHandleAck(OriginAlert& origin, const AlertFrame& frame) {
+  if (!origin.pending || !alertFrameAcks(frame, origin.deviceId, origin.bootId, origin.sequence)) return false;
+  origin.pending = false;
+  return true;
+}
+
+inline bool originRetryDue(const OriginAlert& origin, unsigned long nowMs) {
+  return origin.pending && nowMs - origin.lastSendMs > origin.retryDelayMs;
+}
+
+// Records a re-send at nowMs: the frame is flagged as a retry and the backoff doubles up to the cap.
+inline void originRetried(OriginAlert& origin, unsigned long nowMs) {
+  origin.frame[ALERT_FRAME_OFFSET_FLAGS] |= ALERT_FRAME_FLAG_RETRY;
+  origin.lastSendMs = nowMs;
+  origin.backoffMs = origin.backoffMs * 2 < ORIGIN_RETRY_CAP ? origin.backoffMs * 2 : ORIGIN_RETRY_CAP;
+  origin.retryDelayMs = origin.backoffMs;
+}
+
+#endif // ALERT_ORIGIN_H
@@ -0,0 +1,214 @@
+#ifndef ALERT_PROTOCOL_H
+#define ALERT_PROTOCOL_H
+
+// Text side of the device <-> server protocol: the alert form body, the
+// heartbeat line and the control messages pushed back to the device.
+// Builders write into caller-owned buffers and never leave them unterminated;
+// the parser accepts only well-formed messages, since they come off the network.
+//
+//  Device -> server
+//   POST /alert   name=<name>&device=<id>&boot=<n>&seq=<n>&state=<0|1>
+//                 [&press=<gateway ms>][&hops=<n>&via=<relay id>]
+//   UDP           HEARTBEAT <id> <boot> <alertState> <deviceTimeMs> <name>
+//
+//  Server -> device (UDP control port, or the MQTT control topic)
+//   ACK <id> <seq>                crew acknowledged this alert
+//   CLEAR <id> <seq>              crew cleared this alert
+//   TIME <id> <t0> <t1> <t2>      heartbeat time reply
+//   INTERVAL <id> <ms>            pin the heartbeat interval, 0 = adaptive
+//
+// Fields after the ones listed are ignored, so either side can append new ones.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+constexpr const char* PROTOCOL_HEARTBEAT = "HEARTBEAT";
+constexpr const char* CONTROL_ACK = "ACK";
+constexpr const char* CONTROL_CLEAR = "CLEAR";
+constexpr const char* CONTROL_TIME = "TIME";
+constexpr const char* CONTROL_INTERVAL = "INTERVAL";
+
+constexpr size_t DEVICE_ID_LENGTH = 12;   // Station MAC as hex digits
+constexpr size_t ALERT_FORM_MAX = 224;    // Longest body: 31-byte name fully escaped, every field
+constexpr size_t HEARTBEAT_MAX = 112;
+constexpr size_t CONTROL_MESSAGE_MAX = 64;
+
+struct AlertFormFields {
+  const char* name = "";
+  const char* device = "";
+  uint32_t bootId = 0;
+  uint32_t sequence = 0;
+  bool state = false;
+  uint64_t pressTimeMs = 0; // 0 = clock not synced, field left out
+  int hops = -1;            // Relayed alerts only; -1 leaves hops and via out
+  const char* via = "";
+};
+
+enum ControlType {
+  CONTROL_TYPE_ACK,
+  CONTROL_TYPE_CLEAR,
+  CONTROL_TYPE_TIME,
+  CONTROL_TYPE_INTERVAL
+};
+
+struct ControlMessage {
+  ControlType type;
+  uint32_t sequence;   // ACK, CLEAR
+  uint64_t t0, t1, t2; // TIME
+  uint32_t intervalMs; // INTERVAL
+};
+
+// Appends value to a form body, percent-encoded. Stops before an escape that
+// would not fit, so out stays terminated. Returns the new length.
+inline size_t appendFormEncoded(char* out, size_t cap, size_t len, const char* value) {
+  static const char hex[] = "0123456789ABCDEF";
+  if (len >= cap) return len;
+  for (const char* p = value; *p && len + 3 < cap; p++) {
+    char c = *p;
+    if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~') {
+      out[len++] = c;
+    } else if (c == ' ') {
+      out[len++] = '+';
+    } else {
+      out[len++] = '%';
+      out[len++] = hex[(c >> 4) & 0x0F];
+      out[len++] = hex[c & 0x0F];
+    }
+  }
+  out[len] = '\0';
+  return len;
+}
+
+// Length of value once percent-encoded by appendFormEncoded().
+inline size_t formEncodedLength(const char* value) {
+  size_t len = 0;
+  for (const char* p = value; *p; p++) {
+    char c = *p;
+    bool plain = isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~' || c == ' ';
+    len += plain ? 1 : 3;
+  }
+  return len;
+}
+
+// Adds the result of an snprintf() into out + len to len; false if it was cut off.
+inline bool formAppended(int written, size_t cap, size_t& len) {
+  if (written < 0 || (size_t)written >= cap - len) return false;
+  len += written;
+  return true;
+}
+
+// Builds the alert POST body. "name" stays first for the legacy server.
+// Returns the length, or 0 if the body does not fit (a cut-off body would lose the sequence).
+inline size_t buildAlertForm(char* out, size_t cap, const AlertFormFields& fields) {
+  static const char prefix[] = "name=";
+  if (cap == 0) return 0;
+  out[0] = '\0';
+  size_t len = sizeof(prefix) - 1;
+  if (len + formEncodedLength(fields.name) >= cap) return 0;
+  memcpy(out, prefix, len);
+  len = appendFormEncoded(out, cap, len, fields.name);
+
+  bool fits = formAppended(snprintf(out + len, cap - len, "&device=%s&boot=%lu&seq=%lu&state=%d",
+                                    fields.device, (unsigned long)fields.bootId,
+                                    (unsigned long)fields.sequence, fields.state ? 1 : 0), cap, len);
+  if (fits && fields.pressTimeMs != 0) {
+    fits = formAppended(snprintf(out + len, cap - len, "&press=%llu",
+                                 (unsigned long long)fields.pressTimeMs), cap, len);
+  }
+  if (fits && fields.hops >= 0) {
+    fits = formAppended(snprintf(out + len, cap - len, "&hops=%d&via=%s", fields.hops, fields.via), cap, len);
+  }
+  if (!fits) {
+    out[0] = '\0';
+    return 0;
+  }
+  return len;
+}
+
+// Builds the heartbeat line. The name is last, so a long one is cut rather than the fields.
+// Returns the length, or 0 if even the fixed fields do not fit.
+inline size_t buildHeartbeat(char* out, size_t cap, const char* deviceId, uint32_t bootId,
+                             bool alertState, uint64_t deviceTimeMs, const char* name) {
+  if (cap == 0) return 0;
+  int fixed = snprintf(out, cap, "%s %s %lu %d %llu ", PROTOCOL_HEARTBEAT, deviceId,
+                       (unsigned long)bootId, alertState ? 1 : 0, (unsigned long long)deviceTimeMs);
+  if (fixed < 0 || (size_t)fixed >= cap) {
+    out[0] = '\0';
+    return 0;
+  }
+  size_t len = fixed;
+  for (const char* p = name; *p && len + 1 < cap; p++) {
+    // One line per heartbeat; control characters in a name would break the framing
+    out[len++] = (unsigned char)*p < 0x20 ? ' ' : *p;
+  }
+  out[len] = '\0';
+  return len;
+}
+
+// Fields are separated by spaces; a trailing CR/LF from a line-based sender is fine too.
+inline bool isControlSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Copies the next space-separated token into out. Returns the position after it,
+// or nullptr if there is no token or it does not fit.
+inline const char* controlToken(const char* p, char* out, size_t cap) {
+  while (isControlSpace(*p)) p++;
+  size_t len = 0;
+  while (*p != '\0' && !isControlSpace(*p)) {
+    if (len + 1 >= cap) return nullptr;
+    out[len++] = *p++;
+  }
+  if (len == 0) return nullptr;
+  out[len] = '\0';
+  return p;
+}
+
+// Parses an unsigned decimal field no larger than max: digits only, no sign, no overflow.
+inline const char* controlNumber(const char* p, uint64_t max, uint64_t& value) {
+  while (isControlSpace(*p)) p++;
+  if (*p < '0' || *p > '9') return nullptr;
+  value = 0;
+  while (*p >= '0' && *p <= '9') {
+    uint64_t digit = *p++ - '0';
+    if (value > (max - digit) / 10) return nullptr;
+    value = value * 10 + digit;
+  }
+  if (*p != '\0' && !isControlSpace(*p)) return nullptr;
+  return p;
+}
+
+// Parses a control message addressed to deviceId. Returns false for anything
+// else: another device, an unknown command, or a missing or malformed field.
+inline bool parseControlMessage(const char* buffer, const char* deviceId, ControlMessage& message) {
+  char command[sizeof("INTERVAL")];
+  char target[DEVICE_ID_LENGTH + 1];
+  const char* p = controlToken(buffer, command, sizeof(command));
+  if (p == nullptr) return false;
+  p = controlToken(p, target, sizeof(target));
+  if (p == nullptr || strcmp(target, deviceId) != 0) return false;
+
+  uint64_t value = 0;
+  if (strcmp(command, CONTROL_ACK) == 0 || strcmp(command, CONTROL_CLEAR) == 0) {
+    message.type = strcmp(command, CONTROL_ACK) == 0 ? CONTROL_TYPE_ACK : CONTROL_TYPE_CLEAR;
+    if (controlNumber(p, UINT32_MAX, value) == nullptr) return false;
+    message.sequence = (uint32_t)value;
+  } else if (strcmp(command, CONTROL_TIME) == 0) {
+    message.type = CONTROL_TYPE_TIME;
+    if ((p = controlNumber(p, UINT64_MAX, message.t0)) == nullptr ||
+        (p = controlNumber(p, UINT64_MAX, message.t1)) == nullptr ||
+        controlNumber(p, UINT64_MAX, message.t2) == nullptr) return false;
+  } else if (strcmp(command, CONTROL_INTERVAL) == 0) {
+    message.type = CONTROL_TYPE_INTERVAL;
+    if (controlNumber(p, UINT32_MAX, value) == nullptr) return false;
+    message.intervalMs = (uint32_t)value;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+#endif // ALERT_PROTOCOL_H
@@ -0,0 +1,187 @@
+#ifndef ALERT_RELAY_H
+#define ALERT_RELAY_H
+
+// Store-and-forward decisions for alert frames heard over ESP-NOW.
+//
+// A device that hears a neighbour's alert either delivers it to the server
+// (when it is online itself) or re-broadcasts it one hop further, and carries
+// the ACK back the same way. Each (device, boot, sequence) is handled once;
+// the table remembers the most recent RELAY_HISTORY frames. Nothing here
+// touches the radio, so the rules run unchanged on the host.
+//
+// Several online neighbours usually hear the same alert. Each holds it for a
+// random holdoff before posting, and drops it if it overhears another relay's
+// ACK first, so normally only one of them posts. Two relays whose holdoffs
+// end within one POST of each other still both post; the server drops the
+// copy by (device, boot, sequence).
+
+#include "alert_frame.h"
+
+constexpr uint8_t RELAY_MAX_HOPS = 2;
+constexpr int RELAY_HISTORY = 16;
+constexpr int RELAY_HELD = 4;                  // Alerts waiting out their holdoff
+constexpr unsigned long RELAY_HOLDOFF_MS = 150; // Upper bound; roughly one POST
+
+struct RelayEntry {
+  uint8_t deviceId[ALERT_FRAME_DEVICE_ID_SIZE];
+  uint32_t bootId;
+  uint32_t sequence;
+  bool used;
+  bool delivered;    // Posted to the server, or another relay's ACK heard; repeat the ACK if the origin retries
+  bool rebroadcast;  // Sent on over ESP-NOW; forward the ACK that comes back
+  bool ackForwarded;
+};
+
+struct RelayHeld {
+  uint8_t data[ALERT_FRAME_MAX_SIZE];
+  size_t len;
+  unsigned long deliverAtMs;
+  bool used;
+};
+
+struct RelayTable {
+  RelayEntry entries[RELAY_HISTORY] = {};
+  int next = 0; // Oldest entry, replaced by the next new frame
+  RelayHeld held[RELAY_HELD] = {};
+};
+
+enum RelayAction {
+  RELAY_IGNORE,       // Duplicate, out of hops, already held, or not ours to handle
+  RELAY_HOLD,         // Online: relayHold() it, and deliver once relayTakeDue() returns it
+  RELAY_DELIVER,      // Post to the server now, then relayMarkDelivered() and ACK
+  RELAY_REPEAT_ACK,   // Already delivered; the origin missed the ACK
+  RELAY_REBROADCAST,  // Send on with alertFrameIncrementHops()
+  RELAY_FORWARD_ACK   // Pass the ACK back towards the origin
+};
+
+// True if frame is an ACK for the given alert.
+inline bool alertFrameAcks(const AlertFrame& frame, const uint8_t* deviceId,
+                           uint32_t bootId, uint32_t sequence) {
+  return frame.type == ALERT_FRAME_TYPE_ACK && frame.bootId == bootId && frame.sequence == sequence &&
+         memcmp(frame.deviceId, deviceId, ALERT_FRAME_DEVICE_ID_SIZE) == 0;
+}
+
+// Relays so far; frames without a hop count come straight from the origin.
+inline uint8_t alertFrameHops(const AlertFrame& frame) {
+  AlertTlv hops;
+  if (alertFrameFindTlv(frame, ALERT_TLV_HOP_COUNT, hops) && hops.length == 1) {
+    return hops.value[0];
+  }
+  return 0;
+}
+
+// Bumps the hop count of the frame in data, which frame was decoded from.
+// Returns the new length, or 0 if a hop count cannot be added.
+inline size_t alertFrameIncrementHops(uint8_t* data, size_t cap, size_t len, const AlertFrame& frame) {
+  AlertTlv hops;
+  if (alertFrameFindTlv(frame, ALERT_TLV_HOP_COUNT, hops) && hops.length == 1) {
+    data[hops.value - data] = hops.value[0] + 1;
+    return len;
+  }
+  uint8_t one = 1;
+  return alertFrameAddTlv(data, cap, len, ALERT_TLV_HOP_COUNT, &one, 1);
+}
+
+inline RelayEntry* relayFind(RelayTable& table, const AlertFrame& frame) {
+  for (RelayEntry& entry : table.entries) {
+    if (entry.used && entry.sequence == frame.sequence && entry.bootId == frame.bootId &&
+        memcmp(entry.deviceId, frame.deviceId, sizeof(entry.deviceId)) == 0) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+// Finds the entry for frame, or starts one in place of the oldest.
+inline RelayEntry* relayRemember(RelayTable& table, const AlertFrame& frame) {
+  RelayEntry* entry = relayFind(table, frame);
+  if (entry != nullptr) return entry;
+
+  entry = &table.entries[table.next];
+  table.next = (table.next + 1) % RELAY_HISTORY;
+  memset(entry, 0, sizeof(*entry));
+  memcpy(entry->deviceId, frame.deviceId, sizeof(entry->deviceId));
+  entry->bootId = frame.bootId;
+  entry->sequence = frame.sequence;
+  entry->used = true;
+  return entry;
+}
+
+// The held copy of frame's alert, or nullptr.
+inline RelayHeld* relayFindHeld(RelayTable& table, const AlertFrame& frame) {
+  for (RelayHeld& held : table.held) {
+    AlertFrame heldFrame;
+    if (held.used && decodeAlertFrame(held.data, held.len, heldFrame) &&
+        heldFrame.sequence == frame.sequence && heldFrame.bootId == frame.bootId &&
+        memcmp(heldFrame.deviceId, frame.deviceId, sizeof(heldFrame.deviceId)) == 0) {
+      return &held;
+    }
+  }
+  return nullptr;
+}
+
+inline RelayHeld* relayFreeHeld(RelayTable& table) {
+  for (RelayHeld& held : table.held) {
+    if (!held.used) return &held;
+  }
+  return nullptr;
+}
+
+// Keeps the alert in data until deliverAtMs. False if there is no room; deliver it now instead.
+inline bool relayHold(RelayTable& table, const uint8_t* data, size_t len, unsigned long deliverAtMs) {
+  RelayHeld* held = relayFreeHeld(table);
+  if (held == nullptr || len > sizeof(held->data)) return false;
+  memcpy(held->data, data, len);
+  held->len = len;
+  held->deliverAtMs = deliverAtMs;
+  held->used = true;
+  return true;
+}
+
+// Hands back one held alert whose holdoff has run out, and forgets it.
+inline bool relayTakeDue(RelayTable& table, unsigned long nowMs, RelayHeld& out) {
+  for (RelayHeld& held : table.held) {
+    if (held.used && (long)(nowMs - held.deliverAtMs) >= 0) {
+      out = held;
+      held.used = false;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Decides what to do with a neighbour's frame. online: this device can reach
+// the server now; canRebroadcast: the ESP-NOW radio is on a known channel.
+// Rebroadcasts and forwarded ACKs are recorded here; deliveries only once
+// the caller reports them with relayMarkDelivered().
+inline RelayAction relayDecide(RelayTable& table, const AlertFrame& frame, bool online, bool canRebroadcast) {
+  if (frame.type == ALERT_FRAME_TYPE_ACK) {
+    RelayEntry* entry = relayFind(table, frame);
+    if (entry == nullptr) return RELAY_IGNORE;
+    // The server has it through another relay: drop our held copy, and answer the origin's retries ourselves
+    entry->delivered = true;
+    RelayHeld* held = relayFindHeld(table, frame);
+    if (held != nullptr) held->used = false;
+    if (!entry->rebroadcast || entry->ackForwarded) return RELAY_IGNORE;
+    entry->ackForwarded = true;
+    return RELAY_FORWARD_ACK;
+  }
+  if (frame.type != ALERT_FRAME_TYPE_ALERT) return RELAY_IGNORE;
+
+  RelayEntry* entry = relayRemember(table, frame);
+  if (entry->delivered) return RELAY_REPEAT_ACK;
+  if (online) {
+    if (relayFindHeld(table, frame) != nullptr) return RELAY_IGNORE;
+    return relayFreeHeld(table) != nullptr ? RELAY_HOLD : RELAY_DELIVER;
+  }
+  if (entry->rebroadcast || !canRebroadcast || alertFrameHops(frame) >= RELAY_MAX_HOPS) return RELAY_IGNORE;
+  entry->rebroadcast = true;
+  return RELAY_REBROADCAST;
+}
+
+inline void relayMarkDelivered(RelayTable& table, const AlertFrame& frame) {
+  RelayEntry* entry = relayFind(table, frame);
+  if (entry != nullptr) entry->delivered = true;
+}
+
+#endif // ALERT_RELAY_H
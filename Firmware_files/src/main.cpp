@@ -4,6 +4,18 @@
 #include <EEPROM.h>
 #include <DNSServer.h>
 #include <WiFiUdp.h>
+#include <esp_system.h>
+#include <esp_timer.h>
+#include <lwip/sockets.h>
+#include <esp_now.h>
+#include <esp_wifi.h>
+#include <ArduinoJson.h>
+#include <MQTT.h>
+#include <stddef.h>
+#include "alert_frame.h"
+#include "alert_relay.h"
+#include "alert_origin.h"
+#include "alert_protocol.h"
 
 void handleRoot();
 void handleSave();
@@ -21,6 +33,57 @@ String improvedDiscoverServer();
 void improvedCaptivePortal();
 bool enhancedWiFiConnect();
 void networkDiagnostics();
+void initAlertIdentity();
+void sendHeartbeat(const String& serverIP);
+size_t buildAlertBody(char* out, size_t cap, bool state);
+void recordAlertLatency(unsigned long latencyMs);
+int postAlert(const String& serverIP, const char* body, size_t len);
+String readServerReply();
+void noteServerReply(const String& serverIP);
+void handleControlMessages();
+uint64_t deviceTimeMs();
+uint64_t gatewayTimeMs();
+void updateClockSync(uint64_t t0, uint64_t t1, uint64_t t2, uint64_t t3);
+void updateAckFlash();
+void setPriorityTos(int fd);
+void sendAlertFrame(const String& serverIP, bool state);
+size_t buildAlertFrame(uint8_t* packet, size_t cap, bool state);
+bool initEspNow();
+void onEspNowReceive(const uint8_t* mac, const uint8_t* data, int len);
+bool sendAlertEspNow(bool state);
+void processRelayQueue();
+void espNowAlertAcked();
+void retryEspNowAlert();
+void deliverRelayedAlert(const AlertFrame& frame);
+bool relayAlertFrame(const AlertFrame& frame, uint8_t hopCount);
+void sendRelayAck(const AlertFrame& frame);
+void sendTelemetry(const String& serverIP);
+String locateServer();
+String probePinnedServer();
+bool usePinnedServer();
+bool parseIpField(const char* field, uint8_t* out);
+int alertPort();
+void rememberServer(const String& serverIP);
+unsigned long jitter(unsigned long delayMs, unsigned long spreadMs);
+void scheduleServerCheck(bool success);
+void adaptHeartbeatInterval(bool success);
+void scheduleWifiRetry(bool success);
+void pressFastPath();
+void upgradeConfig();
+const char* networkSsid(int index);
+const char* networkPassword(int index);
+int rankVisibleNetworks(int* order, uint8_t bssids[][6], int32_t* channels);
+bool joinNetwork(int index, const uint8_t* bssid, int32_t channel, int attempts);
+void startJoin(int index, const uint8_t* bssid, int32_t channel);
+void checkRoaming();
+void updateRoam();
+void applyControlMessage(const char* buffer);
+bool connectMqtt();
+String mqttTopic(const char* leaf);
+void handleMqttMessage(MQTTClient* client, char topic[], char bytes[], int length);
+void publishMqttStatus();
+void sendAlertMqtt(bool state);
+void printLatencyHistogram();
 
 // Pins
 const int buttonPin = 25;
@@ -31,6 +94,68 @@ const int bootButtonPin = 0;
 const int UDP_PORT = 12345;
 const char* UDP_REQUEST = "WHERE_IS_SERVER";
 WiFiUDP udp;
+const int ALERT_PORT = 5000;
+
+// DSCP EF (46) in the IP TOS byte; APs map it to the WMM voice access category
+const int ALERT_TOS = 46 << 2;
+
+// Telemetry, MessagePack encoded, sent to the discovery port after each heartbeat.
+// The payload is a map, so its first byte (0x80-0x8f or 0xde) never collides with
+// the text messages or the alert frame magic.
+const int TELEMETRY_VERSION = 1;
+uint8_t telemetryBuffer[256];
+
+// Binary alert frames (alert_frame.h) go to the discovery port ahead of the POST
+int frameSocket = -1;
+
+// ESP-NOW fallback: alert frames broadcast to a bridge ESP32 on the server side
+// while the access point is unreachable. The bridge answers with an ACK frame.
+const uint8_t ESPNOW_BROADCAST[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+const unsigned long espNowAckTimeout = 60; // Wait for a bridge in range before returning to the loop
+bool espNowReady = false;
+uint8_t lastWifiChannel = 0; // Bridge shares the AP's channel
+
+// A relay only ACKs after its own POST, so the frame stays pending (alert_origin.h)
+// and the loop retries it until an ACK arrives or WiFi returns
+OriginAlert espNowOrigin;
+
+// Store-and-forward relay (alert_relay.h): frames heard from neighbours over ESP-NOW
+// are posted to the server on their behalf, or re-broadcast if this device is offline too.
+// ACKs for this device's own alert come through the same queue.
+struct RelayPacket {
+  uint8_t data[ALERT_FRAME_MAX_SIZE];
+  uint16_t len;
+};
+QueueHandle_t relayQueue = NULL;
+RelayTable relayTable;
+
+// Crew control messages pushed from the server
+const int CONTROL_PORT = 12346;
+// Message formats are in alert_protocol.h
+WiFiUDP controlUdp;
+bool controlListening = false;
+
+// Persistent alert connection (HTTP/1.1 keep-alive)
+WiFiClient alertClient;
+HTTPClient alertHttp;
+String alertHost;
+const int alertConnectTimeout = 1000; // LAN only; a dead server should fail over quickly
+
+// Servers that answered discovery; a second responder is the failover target
+String primaryServerIP;
+String backupServerIP;
+
+// Alert transports, chosen in the setup portal
+const uint8_t TRANSPORT_HTTP = 0; // UDP discovery + HTTP POST
+const uint8_t TRANSPORT_MQTT = 1; // Local broker, QoS 1 with a persistent session
+
+// Extra known networks, so a touring device joins whichever venue network it sees
+struct StoredNetwork {
+  char ssid[32];
+  char password[32];
+};
+const int MAX_EXTRA_NETWORKS = 3;
+const int MAX_NETWORKS = MAX_EXTRA_NETWORKS + 1; // Index 0 is config.ssid
 
 // Configuration
 struct Config {
@@ -38,7 +163,53 @@ struct Config {
   char password[32];
   char deviceName[32];
   bool configured;
+  // Fields below were added after the first release; layout tells whether they are valid
+  uint8_t layout;
+  uint8_t transport;
+  char mqttHost[40];
+  uint16_t mqttPort;
+  // Layout 2
+  StoredNetwork networks[MAX_EXTRA_NETWORKS];
+  // Layout 3: fixed installations on the primary network skip DHCP and discovery
+  bool useStaticIp;
+  uint8_t staticIp[4];
+  uint8_t staticNetmask[4];
+  uint8_t staticGateway[4];
+  uint8_t staticDns[4];
+  char pinnedServer[16]; // Dotted IPv4, empty to use discovery
+  uint16_t pinnedPort;
+  // Layout 4: last server that answered, probed by unicast first after a reboot
+  char lastServer[16];
+  uint8_t lastServerNetwork;
 };
+const uint8_t CONFIG_LAYOUT = 4;
+
+// Network selection and roaming
+uint8_t networkFailures[MAX_NETWORKS] = {0}; // Failed joins since boot; ranks flaky networks lower
+int currentNetwork = 0;
+const int roamRssiThreshold = -72; // dBm; below this, look for a stronger AP
+const int roamHysteresis = 8;      // dB a candidate must beat the current AP by
+bool roamScanRunning = false;
+unsigned long lastRoamScanTime = 0;
+const unsigned long roamScanInterval = 30000; // A scan costs ~2 s of reduced throughput
+
+// A roam joins in the background, so the loop (and the button) keeps running meanwhile
+int roamJoining = -1;  // Network being joined, -1 when not roaming
+int roamFallback = -1; // Network to go back to if the roam fails, -1 once used
+uint8_t roamBssid[6];
+bool roamHasBssid = false;
+unsigned long roamStartTime = 0;
+const unsigned long roamJoinTimeout = 5000;
+bool roamAlertQueued = false; // Pressed while the join was in progress; sent once it settles
+
+// MQTT transport
+// Topics: <prefix>/<deviceId>/{alert,status,heartbeat,telemetry,control}
+const char* MQTT_TOPIC_PREFIX = "stagealert";
+const uint16_t MQTT_DEFAULT_PORT = 1883;
+const int mqttKeepAlive = 10; // Seconds; also how fast the broker publishes our will
+WiFiClient mqttNet;
+MQTTClient mqtt(256);
+bool mqttStarted = false;
 
 // State
 Config config;
@@ -51,6 +222,36 @@ unsigned long buttonPressStartTime = 0;
 bool resetTriggered = false;
 bool serverConnected = false;
 
+// Alert identity (lets the server drop retransmitted duplicates)
+uint8_t deviceMac[6];        // Station MAC
+char deviceId[13];           // Station MAC as 12 hex digits
+uint32_t bootId = 0;         // Random per boot, so sequence restarts are not duplicates
+uint32_t alertSequence = 0;  // Incremented once per button press, reused on retries
+
+// Press-to-response latency, bucket i holds [2^(i-1), 2^i) ms, last bucket is open-ended
+const int LATENCY_BUCKETS = 14;
+uint32_t latencyHistogram[LATENCY_BUCKETS] = {0};
+unsigned long latencyMaxMs = 0;
+unsigned long alertPressTime = 0;
+
+// Gateway clock estimate, from the NTP-style exchange piggybacked on heartbeats:
+// gateway = device + clockOffsetMs + clockDriftPpm * (device - clockSyncAtMs) / 1e6
+bool clockSynced = false;
+int64_t clockOffsetMs = 0;
+uint64_t clockSyncAtMs = 0;
+float clockDriftPpm = 0;
+uint32_t clockBestRttMs = UINT32_MAX;
+uint32_t clockOffsetRttMs = UINT32_MAX; // RTT of the sample behind clockOffsetMs
+uint64_t clockDriftAnchorMs = 0;       // Drift is measured between samples at least a span apart
+int64_t clockDriftAnchorOffsetMs = 0;
+const unsigned long clockDriftMinSpanMs = 30000; // Shorter spans are dominated by jitter
+uint64_t alertPressGatewayMs = 0;
+
+// Acknowledgement feedback: a burst of quick flashes, then back to the alert state
+bool alertAcknowledged = false;
+int ackFlashesRemaining = 0;
+const unsigned long ackFlashInterval = 150;
+
 // LED blinking variables
 bool isBlinking = false;
 unsigned long lastBlinkTime = 0;
@@ -58,7 +259,27 @@ const unsigned long blinkInterval = 300; // Fast blink interval in ms
 const unsigned long serverBlinkInterval = 1000; // Slow blink interval for server disconnect
 bool ledState = false;
 unsigned long lastServerCheckTime = 0;
-const unsigned long serverCheckInterval = 10000; // Check server every 10 seconds
+const unsigned long serverCheckInterval = 10000; // Initial server check/heartbeat interval
+
+// Adaptive heartbeat: stretches while checks succeed on a good link (saves power),
+// shrinks after a failure or an RSSI drop (detects loss sooner). The server may pin it.
+const unsigned long heartbeatMinInterval = 3000;
+const unsigned long heartbeatMaxInterval = 30000;
+const int heartbeatGoodRssi = -67;     // dBm; weaker links do not stretch the interval
+const int heartbeatRssiDrop = 10;      // dB fall since the last check that counts as a drop
+unsigned long heartbeatInterval = serverCheckInterval;
+unsigned long heartbeatOverride = 0;   // Set by the server's INTERVAL message, 0 = adaptive
+int32_t lastHeartbeatRssi = 0;
+
+// Retry backoff: failures double the wait up to a cap, and every wait is jittered
+// so a fleet that lost the server (or the AP) at the same moment does not retry in lockstep
+const unsigned long serverBackoffCap = 60000;
+const unsigned long wifiBackoffCap = 60000;
+const unsigned long wifiRetryInterval = 5000;
+unsigned long serverBackoff = heartbeatMinInterval; // Doubled before use, so the first re-check is 3-6 s out
+unsigned long wifiBackoff = wifiRetryInterval;
+bool wifiLinkUp = false; // Last loop saw WL_CONNECTED; a drop restarts the WiFi retry schedule
+unsigned long nextCheckDelay = serverCheckInterval;
 
 void setup() {
   Serial.begin(115200);
@@ -74,8 +295,13 @@ void setup() {
   alertState = false;
   serverConnected = false;
 
+  initAlertIdentity();
+
   EEPROM.begin(sizeof(Config));
   EEPROM.get(0, config);
+  if (config.layout != CONFIG_LAYOUT) {
+    upgradeConfig();
+  }
 
   Serial.println("Checking for reset condition...");
   checkForResetCondition();
@@ -102,6 +328,8 @@ void loop() {
                                    (WiFi.status() == WL_CONNECTED && !serverConnected) ? serverBlinkInterval : 
                                    blinkInterval;
     blinkLED(false, currentInterval);
+  } else {
+    updateAckFlash();
   }
   
   // Reset button check
@@ -116,15 +344,39 @@ void loop() {
     buttonPressStartTime = 0;
   }
 
+  if (config.configured) {
+    updateRoam();
+    if (roamAlertQueued && roamJoining < 0) {
+      roamAlertQueued = false;
+      sendAlert(alertState);
+    }
+  }
+
   // If configured, check connection status periodically
   if (config.configured && WiFi.status() == WL_CONNECTED) {
+    wifiLinkUp = true;
+    if (!controlListening) {
+      controlListening = controlUdp.begin(CONTROL_PORT);
+    }
+    handleControlMessages();
+    checkRoaming();
+    if (!espNowReady && lastWifiChannel != 0) {
+      initEspNow(); // Listen for neighbours that need a relay
+    }
+    if (config.transport == TRANSPORT_MQTT) {
+      mqtt.loop();
+    }
+
     // Periodically check if server is available
-    if (millis() - lastServerCheckTime > serverCheckInterval) {
+    if (millis() - lastServerCheckTime > nextCheckDelay) {
       lastServerCheckTime = millis();
       
+      lastWifiChannel = WiFi.channel();
       Serial.println("Performing periodic server check...");
-      String serverIP = discoverServer();
+      String serverIP = locateServer();
       
+      adaptHeartbeatInterval(!serverIP.isEmpty());
+      scheduleServerCheck(!serverIP.isEmpty());
       if (serverIP.isEmpty()) {
         Serial.println("Server not found on this check");
         if (serverConnected || !isBlinking) {
@@ -135,6 +387,8 @@ void loop() {
         }
       } else {
         Serial.print("Server found at: "); Serial.println(serverIP);
+        sendHeartbeat(serverIP);
+        sendTelemetry(serverIP);
         if (!serverConnected) {
           // Server connected, stop blinking
           serverConnected = true;
@@ -148,21 +402,43 @@ void loop() {
       }
     }
     
-    // Alert button check with debounce (only if server is connected)
-    if (serverConnected && digitalRead(buttonPin) == LOW && millis() - lastDebounceTime > debounceDelay) {
+    // Alert button check with debounce; without a server the press itself
+    // retries discovery immediately instead of waiting out the backoff
+    if (digitalRead(buttonPin) == LOW && millis() - lastDebounceTime > debounceDelay) {
       lastDebounceTime = millis();
       Serial.println("Alert button pressed");
-      toggleAlertState();
+      pressFastPath();
     }
   } else if (config.configured && WiFi.status() != WL_CONNECTED) {
-    // If WiFi disconnected, attempt to reconnect periodically
-    if (millis() - lastServerCheckTime > serverCheckInterval) {
+    if (wifiLinkUp) {
+      // The pending server check may be up to a minute away; the first retry should not be
+      wifiLinkUp = false;
+      wifiBackoff = wifiRetryInterval;
+      lastServerCheckTime = millis();
+      nextCheckDelay = jitter(wifiRetryInterval, wifiRetryInterval / 2);
+      Serial.println("WiFi link lost");
+    }
+    // If WiFi disconnected, attempt to reconnect with backoff (a roam does its own joining)
+    if (roamJoining < 0 && millis() - lastServerCheckTime > nextCheckDelay) {
       lastServerCheckTime = millis();
       Serial.println("WiFi disconnected, attempting to reconnect...");
-      reconnectWiFi();
+      scheduleWifiRetry(reconnectWiFi());
+    }
+
+    // A press goes out over ESP-NOW; if nothing ACKs it at once, or ESP-NOW is
+    // unavailable, the reconnect happens now instead of after the backoff
+    if (digitalRead(buttonPin) == LOW && millis() - lastDebounceTime > debounceDelay) {
+      lastDebounceTime = millis();
+      Serial.println("Alert button pressed (WiFi down)");
+      pressFastPath();
     }
   }
   
+  if (config.configured) {
+    processRelayQueue();
+    retryEspNowAlert();
+  }
+
   // Handle captive portal if not configured
   if (!config.configured) {
     dnsServer.processNextRequest();
@@ -170,6 +446,71 @@ void loop() {
   }
 }
 
+unsigned long jitter(unsigned long delayMs, unsigned long spreadMs) {
+  // Uniform in [delayMs - spreadMs, delayMs]
+  if (spreadMs == 0 || spreadMs > delayMs) return delayMs;
+  return delayMs - esp_random() % (spreadMs + 1);
+}
+
+void scheduleServerCheck(bool success) {
+  // Only reschedules; the periodic check itself adapts the interval first
+  if (success) {
+    serverBackoff = heartbeatMinInterval;
+    nextCheckDelay = jitter(heartbeatInterval, heartbeatInterval / 10);
+  } else {
+    serverBackoff = min(serverBackoff * 2, serverBackoffCap);
+    nextCheckDelay = jitter(serverBackoff, serverBackoff / 2);
+    Serial.print("Next server check in "); Serial.print(nextCheckDelay); Serial.println(" ms");
+  }
+}
+
+void adaptHeartbeatInterval(bool success) {
+  if (heartbeatOverride != 0) {
+    heartbeatInterval = heartbeatOverride;
+    return;
+  }
+
+  int32_t rssi = WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0;
+  bool rssiDropped = rssi != 0 && lastHeartbeatRssi != 0 && rssi < lastHeartbeatRssi - heartbeatRssiDrop;
+  lastHeartbeatRssi = rssi;
+
+  unsigned long previous = heartbeatInterval;
+  if (!success || rssiDropped) {
+    heartbeatInterval = max(heartbeatInterval / 2, heartbeatMinInterval);
+  } else if (rssi >= heartbeatGoodRssi) {
+    heartbeatInterval = min(heartbeatInterval * 3 / 2, heartbeatMaxInterval);
+  }
+  if (heartbeatInterval != previous) {
+    Serial.print("Heartbeat interval now "); Serial.print(heartbeatInterval); Serial.println(" ms");
+  }
+}
+
+void scheduleWifiRetry(bool success) {
+  if (success) {
+    wifiBackoff = wifiRetryInterval;
+    scheduleServerCheck(serverConnected);
+  } else {
+    // The first retry already waited wifiRetryInterval; each failure doubles the wait
+    wifiBackoff = min(wifiBackoff * 2, wifiBackoffCap);
+    nextCheckDelay = jitter(wifiBackoff, wifiBackoff / 2);
+    Serial.print("Next WiFi retry in "); Serial.print(nextCheckDelay); Serial.println(" ms");
+  }
+}
+
+void pressFastPath() {
+  bool wasConnected = WiFi.status() == WL_CONNECTED && serverConnected;
+  toggleAlertState();
+  if (wasConnected || !serverConnected) return;
+
+  // The press found the server (or the AP) before the backoff did; resume the normal cadence
+  lastServerCheckTime = millis();
+  wifiBackoff = wifiRetryInterval;
+  scheduleServerCheck(true);
+  if (isBlinking) {
+    blinkLED(true);
+  }
+}
+
 void blinkLED(bool stop, unsigned long interval) {
   if (stop) {
     isBlinking = false;
@@ -193,13 +534,28 @@ void toggleAlertState() {
   alertState = !alertState;
   ledState = alertState; // Keep ledState in sync with alertState
   digitalWrite(ledPin, alertState ? HIGH : LOW);
-  Serial.print("Alert state toggled to: "); Serial.println(alertState ? "ON" : "OFF");
+  alertSequence++;
+  alertPressTime = millis();
+  alertPressGatewayMs = gatewayTimeMs();
+  alertAcknowledged = false;
+  ackFlashesRemaining = 0;
+  Serial.print("Alert state toggled to: "); Serial.print(alertState ? "ON" : "OFF");
+  Serial.print(" (seq "); Serial.print(alertSequence); Serial.println(")");
   sendAlert(alertState);
 }
 
 void sendAlert(bool state) {
   if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi not connected, cannot send alert");
+    if (roamJoining >= 0) {
+      // Forcing the radio onto the ESP-NOW channel, or a reconnect, would break the join
+      Serial.println("Roam in progress, alert queued until it completes");
+      roamAlertQueued = true;
+      return;
+    }
+    Serial.println("WiFi not connected, trying ESP-NOW fallback");
+    if (sendAlertEspNow(state) || espNowOrigin.pending) {
+      return; // Delivered, or pending with the reconnect brought forward
+    }
     if (!reconnectWiFi()) {
       // Could not reconnect, revert alert state
       alertState = !alertState;
@@ -210,6 +566,14 @@ void sendAlert(bool state) {
     }
   }
 
+  // This press goes over WiFi, so an older frame waiting for an ESP-NOW ACK is superseded
+  espNowOrigin.pending = false;
+
+  if (config.transport == TRANSPORT_MQTT) {
+    sendAlertMqtt(state);
+    return;
+  }
+
   String serverIP = discoverServer();
   if (serverIP.isEmpty()) {
     Serial.println("Server discovery failed, cannot send alert");
@@ -224,43 +588,411 @@ void sendAlert(bool state) {
 
   // Server is available
   serverConnected = true;
+  sendAlertFrame(serverIP, state);
   
-  HTTPClient http;
-  String url = "http://" + serverIP + ":5000/alert";
-  Serial.print("Sending alert to: "); Serial.println(url);
-  
-  http.begin(url);
-  http.addHeader("Content-Type", "application/x-www-form-urlencoded");
-  
-  String postData = "name=" + String(config.deviceName);
+  // "name" stays first for the legacy server; the rest identifies this press
+  char postData[ALERT_FORM_MAX];
+  size_t postLen = buildAlertBody(postData, sizeof(postData), state);
   Serial.print("POST data: "); Serial.println(postData);
-  
-  int httpCode = http.POST(postData);
+
+  int httpCode = postAlert(serverIP, postData, postLen);
+  if (httpCode <= 0 && !backupServerIP.isEmpty() && backupServerIP != serverIP) {
+    // Another server answered discovery; fail over to it without rediscovering
+    Serial.print("Primary server failed, failing over to: "); Serial.println(backupServerIP);
+    String failed = serverIP;
+    serverIP = backupServerIP;
+    httpCode = postAlert(serverIP, postData, postLen);
+    if (httpCode > 0) {
+      primaryServerIP = serverIP;
+      backupServerIP = failed;
+    }
+  }
   
   if (httpCode > 0) {
-    String response = http.getString();
+    unsigned long latencyMs = millis() - alertPressTime;
+    recordAlertLatency(latencyMs);
+    String response = alertHttp.getString();
     Serial.print("Alert "); 
     Serial.print(state ? "activated" : "deactivated");
     Serial.print(" with HTTP code: ");
     Serial.print(httpCode);
-    Serial.print(" - Response: ");
+    Serial.print(" in ");
+    Serial.print(latencyMs);
+    Serial.print(" ms - Response: ");
     Serial.println(response);
+    printLatencyHistogram();
   } else {
     Serial.print("HTTP error: ");
-    Serial.println(http.errorToString(httpCode).c_str());
+    Serial.println(alertHttp.errorToString(httpCode).c_str());
     // Revert state if failed
     alertState = !alertState;
     ledState = alertState; // Keep ledState in sync with alertState
     digitalWrite(ledPin, alertState ? HIGH : LOW);
     Serial.println("HTTP request failed, alert state reverted");
   }
-  http.end();
+  // Keeps the TCP connection open when the server allows keep-alive
+  alertHttp.end();
+}
+
+int postAlert(const String& serverIP, const char* body, size_t len) {
+  // Reuse the open connection unless the server moved
+  if (alertHost != serverIP) {
+    alertClient.stop();
+    alertHost = serverIP;
+  }
+
+  String url = "http://" + serverIP + ":" + String(alertPort()) + "/alert";
+  Serial.print("Sending alert to: "); Serial.println(url);
+
+  int httpCode = -1;
+  for (int attempt = 0; attempt < 2 && httpCode <= 0; attempt++) {
+    bool reused = alertClient.connected();
+    if (attempt > 0) {
+      // The server may have closed an idle keep-alive connection; retry on a fresh one
+      Serial.println("Retrying alert on a new connection");
+      alertClient.stop();
+      reused = false;
+    }
+    // Connect here rather than in HTTPClient so the socket can be marked first
+    if (!reused) {
+      if (!alertClient.connect(serverIP.c_str(), alertPort(), alertConnectTimeout)) {
+        // A fresh connection failing means the server is down; one timeout is enough
+        Serial.println("Could not connect to alert server");
+        break;
+      }
+      setPriorityTos(alertClient.fd());
+    }
+    alertHttp.begin(alertClient, url);
+    alertHttp.setReuse(true);
+    alertHttp.setConnectTimeout(alertConnectTimeout);
+    alertHttp.addHeader("Content-Type", "application/x-www-form-urlencoded");
+    httpCode = alertHttp.POST((uint8_t*)body, len);
+    if (httpCode <= 0) {
+      alertHttp.end();
+      if (!reused) break; // Only a stale keep-alive connection is worth a second try
+    }
+  }
+  return httpCode;
+}
+
+void sendAlertFrame(const String& serverIP, bool state) {
+  // Fast path for servers that speak the binary frame; the POST that follows
+  // carries the same device/boot/sequence, so the server keeps only one
+  IPAddress address;
+  if (!address.fromString(serverIP.c_str())) return;
+
+  if (frameSocket < 0) {
+    frameSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (frameSocket < 0) {
+      Serial.println("Could not open alert frame socket");
+      return;
+    }
+    setPriorityTos(frameSocket);
+  }
+
+  uint8_t packet[ALERT_FRAME_MAX_SIZE];
+  size_t len = buildAlertFrame(packet, sizeof(packet), state);
+
+  struct sockaddr_in to = {};
+  to.sin_family = AF_INET;
+  to.sin_port = htons(UDP_PORT);
+  to.sin_addr.s_addr = (uint32_t)address;
+  if (sendto(frameSocket, packet, len, 0, (struct sockaddr*)&to, sizeof(to)) < 0) {
+    Serial.println("Alert frame send failed");
+  }
+}
+
+size_t buildAlertFrame(uint8_t* packet, size_t cap, bool state) {
+  AlertFrame frame;
+  memcpy(frame.deviceId, deviceMac, sizeof(frame.deviceId));
+  frame.bootId = bootId;
+  frame.sequence = alertSequence;
+  frame.state = state ? 1 : 0;
+  frame.pressTimeMs = alertPressGatewayMs;
+  frame.rssi = WiFi.status() == WL_CONNECTED ? (int8_t)WiFi.RSSI() : 0;
+
+  size_t len = encodeAlertFrame(frame, packet, cap);
+  size_t named = alertFrameAddTlv(packet, cap, len, ALERT_TLV_DEVICE_NAME,
+                                  config.deviceName, strnlen(config.deviceName, sizeof(config.deviceName)));
+  return named > 0 ? named : len;
+}
+
+bool initEspNow() {
+  if (espNowReady) return true;
+  if (esp_now_init() != ESP_OK) {
+    Serial.println("ESP-NOW init failed");
+    return false;
+  }
+  if (relayQueue == NULL) {
+    relayQueue = xQueueCreate(4, sizeof(RelayPacket));
+  }
+  esp_now_register_recv_cb(onEspNowReceive);
+
+  esp_now_peer_info_t peer = {};
+  memcpy(peer.peer_addr, ESPNOW_BROADCAST, sizeof(peer.peer_addr));
+  peer.channel = 0; // Whatever channel the radio is on
+  peer.ifidx = WIFI_IF_STA;
+  peer.encrypt = false;
+  if (esp_now_add_peer(&peer) != ESP_OK) {
+    Serial.println("ESP-NOW peer add failed");
+    esp_now_deinit();
+    return false;
+  }
+  espNowReady = true;
+  return true;
+}
+
+void onEspNowReceive(const uint8_t* mac, const uint8_t* data, int len) {
+  // Runs in the WiFi task; the loop owns the origin and relay state, so just queue the frame
+  if (len <= 0 || len > (int)ALERT_FRAME_MAX_SIZE) return;
+  if (relayQueue != NULL) {
+    RelayPacket packet;
+    memcpy(packet.data, data, len);
+    packet.len = len;
+    xQueueSend(relayQueue, &packet, 0);
+  }
+}
+
+bool sendAlertEspNow(bool state) {
+  // Returns true once a bridge or relay ACKs the press; a newer press replaces whatever was still pending
+  espNowOrigin.pending = false;
+  if (lastWifiChannel == 0 || !initEspNow()) return false;
+
+  // The radio may have wandered while the STA scans for the AP; go back to its channel
+  esp_wifi_set_channel(lastWifiChannel, WIFI_SECOND_CHAN_NONE);
+
+  uint8_t packet[ALERT_FRAME_MAX_SIZE];
+  size_t len = buildAlertFrame(packet, sizeof(packet), state);
+  if (!originStart(espNowOrigin, packet, len, millis())) return false;
+  espNowOrigin.retryDelayMs = jitter(espNowOrigin.backoffMs, espNowOrigin.backoffMs / 2);
+  esp_now_send(ESPNOW_BROADCAST, espNowOrigin.frame, espNowOrigin.length);
+
+  // A bridge in range answers within a few ms; relayed ACKs are picked up by the loop
+  unsigned long start = millis();
+  while (millis() - start < espNowAckTimeout) {
+    processRelayQueue();
+    if (!espNowOrigin.pending) return true;
+    delay(2);
+  }
+  // No bridge or relay answered, so the frame alone may never get through: keep re-sending
+  // it from the loop, and have the loop reconnect now rather than after the WiFi backoff
+  Serial.println("No ESP-NOW ACK, retrying from the loop and reconnecting");
+  wifiBackoff = wifiRetryInterval;
+  lastServerCheckTime = millis();
+  nextCheckDelay = 0;
+  return false;
+}
+
+void espNowAlertAcked() {
+  unsigned long latencyMs = millis() - alertPressTime;
+  recordAlertLatency(latencyMs);
+  Serial.print("Alert ");
+  Serial.print(espNowOrigin.frame[ALERT_FRAME_OFFSET_STATE] ? "activated" : "deactivated");
+  Serial.print(" via ESP-NOW in ");
+  Serial.print(latencyMs);
+  Serial.println(" ms");
+}
+
+void retryEspNowAlert() {
+  if (!espNowOrigin.pending || roamJoining >= 0) return; // Resumes once the join settles
+
+  if (WiFi.status() == WL_CONNECTED) {
+    // Same sequence as the frame, so the server drops it if a relay got there first
+    espNowOrigin.pending = false;
+    Serial.println("WiFi back, sending the alert that was waiting for an ESP-NOW ACK");
+    sendAlert(alertState);
+    return;
+  }
+
+  if (!originRetryDue(espNowOrigin, millis())) return;
+  originRetried(espNowOrigin, millis());
+  espNowOrigin.retryDelayMs = jitter(espNowOrigin.backoffMs, espNowOrigin.backoffMs / 2);
+  esp_wifi_set_channel(lastWifiChannel, WIFI_SECOND_CHAN_NONE);
+  esp_now_send(ESPNOW_BROADCAST, espNowOrigin.frame, espNowOrigin.length);
+}
+
+void processRelayQueue() {
+  if (relayQueue == NULL) return;
+
+  RelayPacket packet;
+  while (xQueueReceive(relayQueue, &packet, 0) == pdTRUE) {
+    AlertFrame frame;
+    if (!decodeAlertFrame(packet.data, packet.len, frame)) continue;
+
+    if (memcmp(frame.deviceId, deviceMac, sizeof(deviceMac)) == 0) {
+      // Our own alert: an ACK from the bridge or a relay, or our frame echoed back by a relay
+      if (originHandleAck(espNowOrigin, frame)) espNowAlertAcked();
+      continue;
+    }
+
+    bool online = WiFi.status() == WL_CONNECTED && serverConnected;
+    // No re-broadcasts while a roam join has the radio off the AP's channel
+    switch (relayDecide(relayTable, frame, online, lastWifiChannel != 0 && roamJoining < 0)) {
+      case RELAY_HOLD:
+        // Other online neighbours heard it too; whoever's holdoff ends first posts, and its ACK cancels ours
+        if (!relayHold(relayTable, packet.data, packet.len, millis() + esp_random() % (RELAY_HOLDOFF_MS + 1))) {
+          deliverRelayedAlert(frame);
+        }
+        break;
+      case RELAY_DELIVER:
+        deliverRelayedAlert(frame);
+        break;
+      case RELAY_REPEAT_ACK:
+        sendRelayAck(frame);
+        break;
+      case RELAY_REBROADCAST: {
+        uint8_t hopCount = alertFrameHops(frame) + 1; // Read before the frame is rewritten
+        size_t len = alertFrameIncrementHops(packet.data, sizeof(packet.data), packet.len, frame);
+        if (len == 0) break;
+        esp_now_send(ESPNOW_BROADCAST, packet.data, len);
+        Serial.print("Re-broadcast neighbour alert, hop "); Serial.println(hopCount);
+        break;
+      }
+      case RELAY_FORWARD_ACK:
+        // Carry the bridge's ACK back towards an origin we re-broadcast for
+        esp_now_send(ESPNOW_BROADCAST, packet.data, packet.len);
+        break;
+      case RELAY_IGNORE:
+        break;
+    }
+  }
+
+  RelayHeld held;
+  while (relayTakeDue(relayTable, millis(), held)) {
+    AlertFrame frame;
+    if (!decodeAlertFrame(held.data, held.len, frame)) continue;
+    // Lost the server during the holdoff; the origin's next retry is decided afresh
+    if (WiFi.status() != WL_CONNECTED || !serverConnected) continue;
+    deliverRelayedAlert(frame);
+  }
+}
+
+void deliverRelayedAlert(const AlertFrame& frame) {
+  if (relayAlertFrame(frame, alertFrameHops(frame) + 1)) {
+    relayMarkDelivered(relayTable, frame);
+    sendRelayAck(frame);
+  }
+}
+
+bool relayAlertFrame(const AlertFrame& frame, uint8_t hopCount) {
+  // Delivered like the origin's own alert, so the server and dashboard treat it the same
+  char name[sizeof(config.deviceName)] = "";
+  AlertTlv tlv;
+  if (alertFrameFindTlv(frame, ALERT_TLV_DEVICE_NAME, tlv)) {
+    size_t nameLength = min((size_t)tlv.length, sizeof(name) - 1);
+    memcpy(name, tlv.value, nameLength);
+    name[nameLength] = '\0';
+  }
+  char origin[13];
+  snprintf(origin, sizeof(origin), "%02X%02X%02X%02X%02X%02X",
+           frame.deviceId[0], frame.deviceId[1], frame.deviceId[2],
+           frame.deviceId[3], frame.deviceId[4], frame.deviceId[5]);
+
+  Serial.print("Relaying alert for "); Serial.print(origin);
+  Serial.print(" (seq "); Serial.print(frame.sequence); Serial.println(")");
+  if (config.transport == TRANSPORT_MQTT) {
+    // Same JSON as the origin would publish, on the origin's alert topic
+    JsonDocument doc;
+    doc["name"] = name;
+    doc["device"] = origin;
+    doc["boot"] = frame.bootId;
+    doc["seq"] = frame.sequence;
+    doc["state"] = frame.state;
+    if (frame.pressTimeMs != 0) {
+      doc["press"] = frame.pressTimeMs;
+    }
+    doc["hops"] = hopCount;
+    doc["via"] = deviceId;
+    char payload[224];
+    size_t payloadLength = serializeJson(doc, payload, sizeof(payload));
+    String topic = String(MQTT_TOPIC_PREFIX) + "/" + String(origin) + "/alert";
+    return connectMqtt() && mqtt.publish(topic.c_str(), payload, payloadLength, false, 1);
+  }
+  if (primaryServerIP.isEmpty()) return false;
+
+  AlertFormFields fields;
+  fields.name = name;
+  fields.device = origin;
+  fields.bootId = frame.bootId;
+  fields.sequence = frame.sequence;
+  fields.state = frame.state != 0;
+  fields.pressTimeMs = frame.pressTimeMs;
+  fields.hops = hopCount;
+  fields.via = deviceId;
+  char body[ALERT_FORM_MAX];
+  size_t len = buildAlertForm(body, sizeof(body), fields);
+  if (len == 0) return false;
+  int httpCode = postAlert(primaryServerIP, body, len);
+  alertHttp.end();
+  return httpCode > 0;
+}
+
+void sendRelayAck(const AlertFrame& frame) {
+  AlertFrame ack;
+  ack.type = ALERT_FRAME_TYPE_ACK;
+  memcpy(ack.deviceId, frame.deviceId, sizeof(ack.deviceId));
+  ack.bootId = frame.bootId;
+  ack.sequence = frame.sequence;
+  ack.state = frame.state;
+
+  uint8_t packet[ALERT_FRAME_HEADER_SIZE];
+  size_t len = encodeAlertFrame(ack, packet, sizeof(packet));
+  esp_now_send(ESPNOW_BROADCAST, packet, len);
+}
+
+void setPriorityTos(int fd) {
+  if (fd < 0) return;
+  int tos = ALERT_TOS;
+  if (setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos)) != 0) {
+    Serial.println("Could not set DSCP on alert socket");
+  }
+}
+
+void recordAlertLatency(unsigned long latencyMs) {
+  int bucket = latencyMs == 0 ? 0 : 32 - __builtin_clz((uint32_t)latencyMs);
+  if (bucket >= LATENCY_BUCKETS) bucket = LATENCY_BUCKETS - 1;
+  latencyHistogram[bucket]++;
+  if (latencyMs > latencyMaxMs) latencyMaxMs = latencyMs;
+}
+
+void printLatencyHistogram() {
+  Serial.println("Press-to-response latency (ms):");
+  uint32_t total = 0;
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    total += latencyHistogram[i];
+    if (latencyHistogram[i] == 0) continue;
+    unsigned long low = i == 0 ? 0 : 1UL << (i - 1);
+    Serial.print("  ");
+    if (i == LATENCY_BUCKETS - 1) {
+      Serial.print(">= "); Serial.print(low);
+    } else {
+      Serial.print(low); Serial.print("-"); Serial.print((1UL << i) - 1);
+    }
+    Serial.print(": "); Serial.println(latencyHistogram[i]);
+  }
+  Serial.print("  Samples: "); Serial.print(total);
+  Serial.print(", Max: "); Serial.println(latencyMaxMs);
+}
+
+size_t buildAlertBody(char* out, size_t cap, bool state) {
+  // Built in place so a button press does not allocate on the heap
+  char name[sizeof(config.deviceName) + 1];
+  snprintf(name, sizeof(name), "%.*s", (int)sizeof(config.deviceName), config.deviceName); // May fill the field
+
+  AlertFormFields fields;
+  fields.name = name;
+  fields.device = deviceId;
+  fields.bootId = bootId;
+  fields.sequence = alertSequence;
+  fields.state = state;
+  fields.pressTimeMs = alertPressGatewayMs; // Gateway milliseconds, only once the clock is synced
+  return buildAlertForm(out, cap, fields);
 }
 
 bool reconnectWiFi() {
   // Start blinking while reconnecting
   isBlinking = true;
-  Serial.print("Reconnecting to WiFi: "); Serial.println(config.ssid);
+  Serial.print("Reconnecting to WiFi: "); Serial.println(networkSsid(currentNetwork));
   
   WiFi.reconnect();
   int attempts = 0;
@@ -275,7 +1007,7 @@ bool reconnectWiFi() {
     printNetworkInfo();
     
     // Check server connection
-    String serverIP = discoverServer();
+    String serverIP = locateServer();
     if (serverIP.isEmpty()) {
       Serial.println("Server unavailable after WiFi reconnect.");
       serverConnected = false;
@@ -297,32 +1029,186 @@ bool reconnectWiFi() {
   }
 }
 
+void sendHeartbeat(const String& serverIP) {
+  // Unicast presence beacon so the server can track which devices are online
+  // The device time doubles as t0 for the server's TIME reply
+  char name[sizeof(config.deviceName) + 1];
+  snprintf(name, sizeof(name), "%.*s", (int)sizeof(config.deviceName), config.deviceName); // May fill the field
+  char packet[HEARTBEAT_MAX];
+  size_t len = buildHeartbeat(packet, sizeof(packet), deviceId, bootId, alertState, deviceTimeMs(), name);
+  if (len == 0) return;
+
+  if (config.transport == TRANSPORT_MQTT) {
+    mqtt.publish(mqttTopic("heartbeat").c_str(), packet, len, false, 0);
+    return;
+  }
+  udp.beginPacket(serverIP.c_str(), UDP_PORT);
+  udp.write((const uint8_t*)packet, len);
+  udp.endPacket();
+}
+
+void sendTelemetry(const String& serverIP) {
+  JsonDocument doc;
+  doc["v"] = TELEMETRY_VERSION;
+  doc["id"] = deviceId;
+  doc["boot"] = bootId;
+  doc["uptime"] = (uint32_t)(deviceTimeMs() / 1000);
+  doc["reset"] = (int)esp_reset_reason();
+  doc["rssi"] = WiFi.RSSI();
+  doc["heap"] = ESP.getFreeHeap();
+  doc["heapMin"] = ESP.getMinFreeHeap();
+  doc["seq"] = alertSequence;
+  doc["alert"] = alertState;
+  doc["hb"] = heartbeatInterval;
+  // Battery voltage is not measured yet, so the field is left out
+
+  JsonArray latency = doc["lat"].to<JsonArray>();
+  for (int i = 0; i < LATENCY_BUCKETS; i++) {
+    latency.add(latencyHistogram[i]);
+  }
+  doc["latMax"] = latencyMaxMs;
+
+  // serializeMsgPack() truncates silently, so check the size up front
+  if (doc.overflowed() || measureMsgPack(doc) > sizeof(telemetryBuffer)) {
+    Serial.println("Telemetry did not fit, not sent");
+    return;
+  }
+  size_t len = serializeMsgPack(doc, telemetryBuffer, sizeof(telemetryBuffer));
+  if (len == 0) return;
+
+  if (config.transport == TRANSPORT_MQTT) {
+    mqtt.publish(mqttTopic("telemetry").c_str(), (const char*)telemetryBuffer, len, false, 0);
+    return;
+  }
+  udp.beginPacket(serverIP.c_str(), UDP_PORT);
+  udp.write(telemetryBuffer, len);
+  udp.endPacket();
+}
+
 String discoverServer() {
+  // A pinned server on the primary network needs no broadcast; a press uses it
+  // straight away and the periodic check (locateServer) confirms it still answers
+  if (usePinnedServer()) {
+    primaryServerIP = config.pinnedServer;
+    return primaryServerIP;
+  }
   return improvedDiscoverServer();
 }
 
+bool usePinnedServer() {
+  return config.pinnedServer[0] != '\0' && currentNetwork == 0;
+}
+
+String probePinnedServer() {
+  // Same request as discovery, unicast to the pinned address only
+  while (udp.parsePacket() > 0) {
+    udp.flush();
+  }
+  IPAddress pinned;
+  pinned.fromString(config.pinnedServer);
+
+  for (int attempt = 0; attempt < 3; attempt++) {
+    udp.beginPacket(config.pinnedServer, UDP_PORT);
+    udp.write((const uint8_t*)UDP_REQUEST, strlen(UDP_REQUEST));
+    udp.endPacket();
+
+    unsigned long attemptTimeout = (250UL << attempt) + esp_random() % 100;
+    unsigned long start = millis();
+    while (millis() - start < attemptTimeout) {
+      if (udp.parsePacket() > 0) {
+        bool fromPinned = udp.remoteIP() == pinned;
+        if (!readServerReply().isEmpty() && fromPinned) {
+          primaryServerIP = config.pinnedServer;
+          return primaryServerIP;
+        }
+      }
+      delay(5);
+    }
+  }
+  Serial.print("Pinned server did not answer: "); Serial.println(config.pinnedServer);
+  return "";
+}
+
+void rememberServer(const String& serverIP) {
+  // Flash is only written when the server actually changes; with two active
+  // servers either answering first, the stored one still counts as current.
+  // Nothing stored yet (empty, like a missing backup) always counts as a change.
+  bool stored = config.lastServer[0] != '\0';
+  if (stored && config.lastServerNetwork == currentNetwork &&
+      (serverIP == config.lastServer || backupServerIP == config.lastServer)) return;
+  if (!stored) {
+    Serial.println("No server remembered yet, saving the first one");
+  }
+  strncpy(config.lastServer, serverIP.c_str(), sizeof(config.lastServer) - 1);
+  config.lastServer[sizeof(config.lastServer) - 1] = '\0';
+  config.lastServerNetwork = currentNetwork;
+  EEPROM.put(0, config);
+  EEPROM.commit();
+  Serial.print("Remembered server: "); Serial.println(config.lastServer);
+}
+
+int alertPort() {
+  if (usePinnedServer() && config.pinnedPort != 0) {
+    return config.pinnedPort;
+  }
+  return ALERT_PORT;
+}
+
+String locateServer() {
+  // With MQTT the broker address is provisioned, so there is nothing to discover
+  if (config.transport == TRANSPORT_MQTT) {
+    return connectMqtt() ? String(config.mqttHost) : String("");
+  }
+  // Server checks need an answer, even from a pinned server
+  return usePinnedServer() ? probePinnedServer() : improvedDiscoverServer();
+}
+
 String improvedDiscoverServer() {
   Serial.println("Attempting server discovery...");
   
+  // Late replies are stale as answers, but one from another server is a usable backup
+  while (udp.parsePacket() > 0) {
+    noteServerReply(readServerReply());
+  }
+
+  // The server from last time usually still answers; probe it directly alongside the broadcast
+  bool warmStart = config.lastServer[0] != '\0' && config.lastServerNetwork == currentNetwork;
+
   // Try 3 times
   for (int attempt = 0; attempt < 3; attempt++) {
     Serial.print("Discovery attempt "); Serial.println(attempt + 1);
     
+    if (warmStart) {
+      udp.beginPacket(config.lastServer, UDP_PORT);
+      udp.write((const uint8_t*)UDP_REQUEST, strlen(UDP_REQUEST));
+      udp.endPacket();
+    }
     udp.beginPacket("255.255.255.255", UDP_PORT);
     udp.write((const uint8_t*)UDP_REQUEST, strlen(UDP_REQUEST));
     udp.endPacket();
     
+    // 250, 500, 1000 ms plus jitter, so rebroadcasts from many devices do not align
+    unsigned long attemptTimeout = (250UL << attempt) + esp_random() % 100;
     unsigned long start = millis();
-    while (millis() - start < 1000) { // 1 second per attempt
+    while (millis() - start < attemptTimeout) {
       int packetSize = udp.parsePacket();
       if (packetSize) {
-        char buffer[16];
-        int len = udp.read(buffer, 15);
-        buffer[len] = '\0';
-        Serial.print("Server found at: "); Serial.println(buffer);
-        return String(buffer);
+        String serverIP = readServerReply();
+        if (!serverIP.isEmpty()) {
+          Serial.print("Server found at: "); Serial.println(serverIP);
+          primaryServerIP = serverIP;
+          if (backupServerIP == serverIP) {
+            backupServerIP = "";
+          }
+          // Other servers answering the same broadcast are already queued
+          while (udp.parsePacket() > 0) {
+            noteServerReply(readServerReply());
+          }
+          rememberServer(serverIP);
+          return serverIP;
+        }
       }
-      delay(50);
+      delay(5); // Short poll, so a fast unicast answer is not held back
     }
     Serial.println("No response in this attempt");
   }
@@ -331,6 +1217,289 @@ String improvedDiscoverServer() {
   return "";
 }
 
+void handleControlMessages() {
+  int packetSize = controlUdp.parsePacket();
+  if (packetSize <= 0) return;
+
+  char buffer[CONTROL_MESSAGE_MAX];
+  if (packetSize >= (int)sizeof(buffer)) {
+    controlUdp.flush(); // Cut short, a TIME or sequence field could parse as a different number
+    return;
+  }
+  int len = controlUdp.read(buffer, sizeof(buffer) - 1);
+  controlUdp.flush();
+  if (len <= 0) return;
+  buffer[len] = '\0';
+
+  // Only the servers this device talks to may change its alert state
+  String sender = controlUdp.remoteIP().toString();
+  if (sender != primaryServerIP && sender != backupServerIP) {
+    Serial.print("Ignoring control message from: "); Serial.println(sender);
+    return;
+  }
+
+  applyControlMessage(buffer);
+}
+
+void applyControlMessage(const char* buffer) {
+  ControlMessage message;
+  if (!parseControlMessage(buffer, deviceId, message)) return;
+
+  switch (message.type) {
+    case CONTROL_TYPE_TIME: {
+      uint64_t t3 = deviceTimeMs();
+      if (message.t0 == 0 || message.t1 == 0 || message.t2 == 0 || message.t0 > t3) return;
+      updateClockSync(message.t0, message.t1, message.t2, t3);
+      break;
+    }
+    case CONTROL_TYPE_INTERVAL:
+      // The server may go below or above the adaptive bounds, but not to extremes
+      heartbeatOverride = message.intervalMs == 0 ? 0 : constrain((unsigned long)message.intervalMs, 1000UL, 300000UL);
+      if (heartbeatOverride != 0) {
+        // Takes effect now, not after the check that was scheduled under the old interval
+        heartbeatInterval = heartbeatOverride;
+        lastServerCheckTime = millis();
+        nextCheckDelay = heartbeatOverride;
+      }
+      Serial.print("Heartbeat interval ");
+      if (heartbeatOverride != 0) {
+        Serial.print("pinned by server to "); Serial.print(heartbeatOverride); Serial.println(" ms");
+      } else {
+        Serial.println("back to adaptive");
+      }
+      break;
+    case CONTROL_TYPE_ACK:
+      // The server may repeat an ACK; only the first one for the current alert counts
+      if (!alertState || message.sequence != alertSequence || alertAcknowledged) return;
+      alertAcknowledged = true;
+      ackFlashesRemaining = 6;
+      Serial.print("Alert acknowledged by crew (seq "); Serial.print(message.sequence); Serial.println(")");
+      break;
+    case CONTROL_TYPE_CLEAR:
+      // A late or repeated CLEAR must not cancel an alert raised after the crew cleared
+      if (!alertState || message.sequence != alertSequence) return;
+      alertState = false;
+      alertAcknowledged = false;
+      ackFlashesRemaining = 0;
+      if (!isBlinking) {
+        ledState = false;
+        digitalWrite(ledPin, LOW);
+      }
+      Serial.println("Alert cleared by crew");
+      if (config.transport == TRANSPORT_MQTT) {
+        publishMqttStatus();
+      }
+      break;
+  }
+}
+
+String mqttTopic(const char* leaf) {
+  return String(MQTT_TOPIC_PREFIX) + "/" + String(deviceId) + "/" + String(leaf);
+}
+
+bool connectMqtt() {
+  if (mqtt.connected()) return true;
+
+  if (!mqttStarted) {
+    mqtt.begin(config.mqttHost, config.mqttPort, mqttNet);
+    mqtt.setKeepAlive(mqttKeepAlive);
+    // Persistent session: the broker keeps our subscription and queues QoS 1
+    // control messages while we are away
+    mqtt.setCleanSession(false);
+    mqtt.setWill(mqttTopic("status").c_str(), "{\"online\":false}", true, 1);
+    mqtt.onMessageAdvanced(handleMqttMessage);
+    mqttStarted = true;
+  }
+
+  Serial.print("Connecting to MQTT broker: ");
+  Serial.print(config.mqttHost); Serial.print(":"); Serial.println(config.mqttPort);
+  String clientId = "stagealert-" + String(deviceId);
+  if (!mqtt.connect(clientId.c_str())) {
+    Serial.print("MQTT connect failed, error: "); Serial.println((int)mqtt.lastError());
+    return false;
+  }
+  setPriorityTos(mqttNet.fd());
+
+  if (!mqtt.sessionPresent()) {
+    mqtt.subscribe(mqttTopic("control").c_str(), 1);
+  }
+  publishMqttStatus();
+  Serial.println("MQTT connected");
+  return true;
+}
+
+void handleMqttMessage(MQTTClient* client, char topic[], char bytes[], int length) {
+  // Same text messages as the UDP control port; the broker stands in for the sender check
+  char buffer[CONTROL_MESSAGE_MAX];
+  if (length < 0 || length >= (int)sizeof(buffer)) return;
+  memcpy(buffer, bytes, length);
+  buffer[length] = '\0';
+  applyControlMessage(buffer);
+}
+
+void publishMqttStatus() {
+  // Retained, so dashboards see every device's last state as soon as they subscribe
+  JsonDocument doc;
+  doc["online"] = true;
+  doc["name"] = config.deviceName;
+  doc["boot"] = bootId;
+  doc["alert"] = alertState;
+  doc["seq"] = alertSequence;
+
+  char payload[128];
+  size_t len = serializeJson(doc, payload, sizeof(payload));
+  mqtt.publish(mqttTopic("status").c_str(), payload, len, true, 1);
+}
+
+void sendAlertMqtt(bool state) {
+  JsonDocument doc;
+  doc["name"] = config.deviceName;
+  doc["device"] = deviceId;
+  doc["boot"] = bootId;
+  doc["seq"] = alertSequence;
+  doc["state"] = state ? 1 : 0;
+  if (alertPressGatewayMs != 0) {
+    doc["press"] = alertPressGatewayMs;
+  }
+
+  char payload[192];
+  size_t len = serializeJson(doc, payload, sizeof(payload));
+  Serial.print("Publishing alert: "); Serial.println(payload);
+
+  // QoS 1 publish returns once the broker has acknowledged it
+  bool sent = connectMqtt() &&
+              mqtt.publish(mqttTopic("alert").c_str(), payload, len, false, 1);
+
+  if (sent) {
+    serverConnected = true;
+    unsigned long latencyMs = millis() - alertPressTime;
+    recordAlertLatency(latencyMs);
+    Serial.print("Alert ");
+    Serial.print(state ? "activated" : "deactivated");
+    Serial.print(" via MQTT in ");
+    Serial.print(latencyMs);
+    Serial.println(" ms");
+    printLatencyHistogram();
+    publishMqttStatus();
+  } else {
+    Serial.println("MQTT publish failed");
+    // Revert state if failed
+    alertState = !alertState;
+    ledState = alertState; // Keep ledState in sync with alertState
+    digitalWrite(ledPin, alertState ? HIGH : LOW);
+    Serial.println("MQTT publish failed, alert state reverted");
+  }
+}
+
+void upgradeConfig() {
+  Serial.println("Upgrading stored configuration layout");
+  // Configs saved before the layout byte existed hold garbage there
+  uint8_t from = config.layout > CONFIG_LAYOUT ? 0 : config.layout;
+
+  // Clear every field newer than the stored layout
+  size_t start = from < 1 ? offsetof(Config, layout) :
+                 from < 2 ? offsetof(Config, networks) :
+                 from < 3 ? offsetof(Config, useStaticIp) :
+                 offsetof(Config, lastServer);
+  memset((uint8_t*)&config + start, 0, sizeof(Config) - start);
+  if (from < 1) {
+    config.transport = TRANSPORT_HTTP;
+    config.mqttPort = MQTT_DEFAULT_PORT;
+  }
+  config.layout = CONFIG_LAYOUT;
+  if (config.configured) {
+    EEPROM.put(0, config);
+    EEPROM.commit();
+  }
+}
+
+uint64_t deviceTimeMs() {
+  // 64-bit, so unlike millis() it does not wrap during a run of shows
+  return esp_timer_get_time() / 1000;
+}
+
+uint64_t gatewayTimeMs() {
+  if (!clockSynced) return 0;
+  uint64_t now = deviceTimeMs();
+  int64_t drift = (int64_t)(clockDriftPpm * (float)(now - clockSyncAtMs) / 1e6f);
+  return now + clockOffsetMs + drift;
+}
+
+void updateClockSync(uint64_t t0, uint64_t t1, uint64_t t2, uint64_t t3) {
+  // t0/t3: device send/receive, t1/t2: gateway receive/send
+  int64_t rtt = (int64_t)(t3 - t0) - ((int64_t)t2 - (int64_t)t1);
+  if (rtt < 0) rtt = 0;
+  int64_t offset = (((int64_t)t1 - (int64_t)t0) + ((int64_t)t2 - (int64_t)t3)) / 2;
+
+  // Queued samples carry asymmetric delay; the best RTT ages so the filter can recover
+  if (clockSynced && rtt > 2 * (int64_t)clockBestRttMs + 5) {
+    clockBestRttMs++;
+    return;
+  }
+  if (rtt < clockBestRttMs) clockBestRttMs = rtt;
+
+  // Like NTP, the offset comes from the lowest-RTT sample; drift has its own anchor
+  bool better = !clockSynced || rtt < clockOffsetRttMs;
+  if (!clockSynced) {
+    clockDriftAnchorMs = t3;
+    clockDriftAnchorOffsetMs = offset;
+  } else if (t3 - clockDriftAnchorMs >= clockDriftMinSpanMs) {
+    float measuredPpm = (float)(offset - clockDriftAnchorOffsetMs) * 1e6f / (float)(t3 - clockDriftAnchorMs);
+    clockDriftPpm = 0.8f * clockDriftPpm + 0.2f * measuredPpm;
+    clockDriftAnchorMs = t3;
+    clockDriftAnchorOffsetMs = offset;
+    better = true; // The old best sample has aged a full span; start over from this one
+  }
+  if (!better) return;
+
+  clockOffsetMs = offset;
+  clockSyncAtMs = t3;
+  clockOffsetRttMs = rtt;
+  if (!clockSynced) {
+    clockSynced = true;
+    Serial.print("Clock synced to server, offset ");
+    Serial.print((long)offset); Serial.print(" ms, RTT ");
+    Serial.print((long)rtt); Serial.println(" ms");
+  }
+}
+
+void updateAckFlash() {
+  if (ackFlashesRemaining <= 0 || millis() - lastBlinkTime <= ackFlashInterval) return;
+  lastBlinkTime = millis();
+  ackFlashesRemaining--;
+  // An even number of toggles always leaves the LED matching the alert state
+  ledState = ackFlashesRemaining == 0 ? alertState : !ledState;
+  digitalWrite(ledPin, ledState ? HIGH : LOW);
+}
+
+void initAlertIdentity() {
+  esp_read_mac(deviceMac, ESP_MAC_WIFI_STA); // Valid before the WiFi driver starts
+  snprintf(deviceId, sizeof(deviceId), "%02X%02X%02X%02X%02X%02X",
+           deviceMac[0], deviceMac[1], deviceMac[2], deviceMac[3], deviceMac[4], deviceMac[5]);
+  bootId = esp_random();
+  alertSequence = 0;
+  Serial.print("Device ID: "); Serial.print(deviceId);
+  Serial.print(" Boot ID: "); Serial.println(bootId);
+}
+
+String readServerReply() {
+  char buffer[16];
+  int len = udp.read(buffer, 15);
+  udp.flush();
+  if (len <= 0) return "";
+  buffer[len] = '\0';
+
+  IPAddress address;
+  if (!address.fromString(buffer)) return "";
+  return String(buffer);
+}
+
+void noteServerReply(const String& serverIP) {
+  if (serverIP.isEmpty() || serverIP == primaryServerIP || serverIP == backupServerIP) return;
+  backupServerIP = serverIP;
+  Serial.print("Backup server found at: "); Serial.println(serverIP);
+}
+
 void checkForResetCondition() {
   if (digitalRead(bootButtonPin) == LOW) {
     delay(100); // Debounce
@@ -404,7 +1573,7 @@ void handleRoot() {
       body { font-family: Arial, sans-serif; max-width: 400px; margin: 0 auto; padding: 20px; }
       h1 { color: #444; text-align: center; }
       form { background: #f9f9f9; padding: 20px; border-radius: 5px; }
-      input { width: 100%; padding: 10px; margin: 8px 0; box-sizing: border-box; }
+      input, select { width: 100%; padding: 10px; margin: 8px 0; box-sizing: border-box; }
       input[type=submit] { background: #4CAF50; color: white; border: none; }
     </style>
   </head>
@@ -417,6 +1586,28 @@ void handleRoot() {
       <input type="password" id="password" name="password" placeholder="Your WiFi password">
       <label for="deviceName">Device Name:</label>
       <input type="text" id="deviceName" name="deviceName" required placeholder="e.g., John's Device">
+      <label for="ssid2">Other WiFi Networks (optional):</label>
+      <input type="text" id="ssid2" name="ssid2" placeholder="Second network name">
+      <input type="password" name="password2" placeholder="Second network password">
+      <input type="text" name="ssid3" placeholder="Third network name">
+      <input type="password" name="password3" placeholder="Third network password">
+      <label for="staticIp">Static IP (optional, primary network):</label>
+      <input type="text" id="staticIp" name="staticIp" placeholder="Leave empty for DHCP">
+      <input type="text" name="staticNetmask" placeholder="Netmask, e.g., 255.255.255.0">
+      <input type="text" name="staticGateway" placeholder="Gateway, e.g., 192.168.1.1">
+      <input type="text" name="staticDns" placeholder="DNS (optional)">
+      <label for="pinnedServer">Alert Server (optional, skips discovery):</label>
+      <input type="text" id="pinnedServer" name="pinnedServer" placeholder="e.g., 192.168.1.10">
+      <input type="number" name="pinnedPort" placeholder="5000">
+      <label for="transport">Alert Transport:</label>
+      <select id="transport" name="transport">
+        <option value="http">Alert server (automatic discovery)</option>
+        <option value="mqtt">MQTT broker</option>
+      </select>
+      <label for="mqttHost">MQTT Broker (MQTT only):</label>
+      <input type="text" id="mqttHost" name="mqttHost" placeholder="e.g., 192.168.1.10">
+      <label for="mqttPort">MQTT Port:</label>
+      <input type="number" id="mqttPort" name="mqttPort" placeholder="1883">
       <input type="submit" value="Save Configuration">
     </form>
   </body>
@@ -426,9 +1617,67 @@ void handleRoot() {
 }
 
 void handleSave() {
+  // The network being replaced stays known, so the device still joins it at the next venue
+  StoredNetwork previous[MAX_NETWORKS];
+  for (int i = 0; i < MAX_NETWORKS; i++) {
+    strncpy(previous[i].ssid, networkSsid(i), sizeof(previous[i].ssid));
+    strncpy(previous[i].password, networkPassword(i), sizeof(previous[i].password));
+  }
+  memset(config.networks, 0, sizeof(config.networks));
+
   strncpy(config.ssid, server.arg("ssid").c_str(), sizeof(config.ssid));
   strncpy(config.password, server.arg("password").c_str(), sizeof(config.password));
   strncpy(config.deviceName, server.arg("deviceName").c_str(), sizeof(config.deviceName));
+  config.layout = CONFIG_LAYOUT;
+  config.transport = server.arg("transport") == "mqtt" ? TRANSPORT_MQTT : TRANSPORT_HTTP;
+  strncpy(config.mqttHost, server.arg("mqttHost").c_str(), sizeof(config.mqttHost) - 1);
+  config.mqttHost[sizeof(config.mqttHost) - 1] = '\0';
+  int mqttPort = server.arg("mqttPort").toInt();
+  config.mqttPort = mqttPort > 0 && mqttPort < 65536 ? mqttPort : MQTT_DEFAULT_PORT;
+  if (config.transport == TRANSPORT_MQTT && strlen(config.mqttHost) == 0) {
+    Serial.println("No MQTT broker given, falling back to HTTP");
+    config.transport = TRANSPORT_HTTP;
+  }
+
+  // Static addressing needs at least an address, netmask and gateway
+  config.useStaticIp = parseIpField("staticIp", config.staticIp) &&
+                       parseIpField("staticNetmask", config.staticNetmask) &&
+                       parseIpField("staticGateway", config.staticGateway);
+  if (!parseIpField("staticDns", config.staticDns)) {
+    memcpy(config.staticDns, config.staticGateway, sizeof(config.staticDns));
+  }
+  uint8_t pinned[4];
+  memset(config.pinnedServer, 0, sizeof(config.pinnedServer));
+  if (parseIpField("pinnedServer", pinned)) {
+    snprintf(config.pinnedServer, sizeof(config.pinnedServer), "%u.%u.%u.%u",
+             pinned[0], pinned[1], pinned[2], pinned[3]);
+  }
+  int pinnedPort = server.arg("pinnedPort").toInt();
+  config.pinnedPort = pinnedPort > 0 && pinnedPort < 65536 ? pinnedPort : ALERT_PORT;
+  // Network indexes are reassigned below, so a remembered server could be matched to the wrong network
+  memset(config.lastServer, 0, sizeof(config.lastServer));
+  config.lastServerNetwork = 0;
+
+  int stored = 0;
+  const char* extraFields[][2] = {{"ssid2", "password2"}, {"ssid3", "password3"}};
+  for (auto& field : extraFields) {
+    String ssid = server.arg(field[0]);
+    if (ssid.isEmpty() || ssid == config.ssid || stored >= MAX_EXTRA_NETWORKS) continue;
+    strncpy(config.networks[stored].ssid, ssid.c_str(), sizeof(config.networks[stored].ssid) - 1);
+    strncpy(config.networks[stored].password, server.arg(field[1]).c_str(),
+            sizeof(config.networks[stored].password) - 1);
+    stored++;
+  }
+  for (int i = 0; i < MAX_NETWORKS && stored < MAX_EXTRA_NETWORKS; i++) {
+    if (previous[i].ssid[0] == '\0' || strncmp(previous[i].ssid, config.ssid, sizeof(config.ssid)) == 0) continue;
+    bool known = false;
+    for (int j = 0; j < stored; j++) {
+      known = known || strncmp(previous[i].ssid, config.networks[j].ssid, sizeof(previous[i].ssid)) == 0;
+    }
+    if (!known) {
+      config.networks[stored++] = previous[i];
+    }
+  }
   config.configured = true;
   
   EEPROM.put(0, config);
@@ -440,6 +1689,16 @@ void handleSave() {
   ESP.restart();
 }
 
+bool parseIpField(const char* field, uint8_t* out) {
+  IPAddress address;
+  if (!address.fromString(server.arg(field))) {
+    memset(out, 0, 4);
+    return false;
+  }
+  for (int i = 0; i < 4; i++) out[i] = address[i];
+  return true;
+}
+
 void connectToWiFi() {
   enhancedWiFiConnect(); // Call the function but don't return its value
 }
@@ -449,21 +1708,34 @@ bool enhancedWiFiConnect() {
   
   WiFi.disconnect();
   delay(100);
-  WiFi.begin(config.ssid, config.password);
-  
-  int attempts = 0;
-  while (WiFi.status() != WL_CONNECTED && attempts < 20) {
-    delay(500);
-    Serial.print(".");
-    attempts++;
+
+  // Strongest visible known network first; hidden networks are not in the scan,
+  // so the configured one is still tried blind if no visible one could be joined
+  bool primaryTriedBlind = false;
+  if (config.useStaticIp) {
+    // Fixed installation: skip the scan too, and only rank networks if the primary is gone
+    joinNetwork(0, NULL, 0, 20);
+    primaryTriedBlind = true;
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    int order[MAX_NETWORKS];
+    uint8_t bssids[MAX_NETWORKS][6];
+    int32_t channels[MAX_NETWORKS];
+    int candidates = rankVisibleNetworks(order, bssids, channels);
+    for (int i = 0; i < candidates && WiFi.status() != WL_CONNECTED; i++) {
+      joinNetwork(order[i], bssids[order[i]], channels[order[i]], i == 0 ? 20 : 10);
+    }
+    if (WiFi.status() != WL_CONNECTED && !primaryTriedBlind) {
+      joinNetwork(0, NULL, 0, 20);
+    }
   }
-  Serial.println("");
   
   if (WiFi.status() == WL_CONNECTED) {
     printNetworkInfo();
+    lastWifiChannel = WiFi.channel();
     
     // Now check for server availability
-    String serverIP = discoverServer();
+    String serverIP = locateServer();
     if (serverIP.isEmpty()) {
       Serial.println("Server unavailable. LED will indicate disconnected state.");
       serverConnected = false;
@@ -488,6 +1760,175 @@ bool enhancedWiFiConnect() {
   }
 }
 
+const char* networkSsid(int index) {
+  return index == 0 ? config.ssid : config.networks[index - 1].ssid;
+}
+
+const char* networkPassword(int index) {
+  return index == 0 ? config.password : config.networks[index - 1].password;
+}
+
+int rankVisibleNetworks(int* order, uint8_t bssids[][6], int32_t* channels) {
+  Serial.println("Scanning for known networks...");
+  int found = WiFi.scanNetworks();
+  int32_t bestRssi[MAX_NETWORKS];
+  int count = 0;
+
+  for (int i = 0; i < MAX_NETWORKS; i++) {
+    bestRssi[i] = INT32_MIN;
+    if (networkSsid(i)[0] == '\0') continue;
+    // Strongest BSSID of this network
+    for (int j = 0; j < found; j++) {
+      if (WiFi.SSID(j) == networkSsid(i) && WiFi.RSSI(j) > bestRssi[i]) {
+        bestRssi[i] = WiFi.RSSI(j);
+        memcpy(bssids[i], WiFi.BSSID(j), 6);
+        channels[i] = WiFi.channel(j);
+      }
+    }
+    if (bestRssi[i] != INT32_MIN) {
+      order[count++] = i;
+    }
+  }
+  WiFi.scanDelete();
+
+  // Signal, minus 10 dB per recent failed join (insertion sort, at most 4 entries)
+  for (int i = 1; i < count; i++) {
+    int candidate = order[i];
+    int32_t score = bestRssi[candidate] - 10 * networkFailures[candidate];
+    int j = i - 1;
+    while (j >= 0 && bestRssi[order[j]] - 10 * networkFailures[order[j]] < score) {
+      order[j + 1] = order[j];
+      j--;
+    }
+    order[j + 1] = candidate;
+  }
+
+  for (int i = 0; i < count; i++) {
+    Serial.print("  "); Serial.print(networkSsid(order[i]));
+    Serial.print(" ("); Serial.print(bestRssi[order[i]]); Serial.println(" dBm)");
+  }
+  return count;
+}
+
+bool joinNetwork(int index, const uint8_t* bssid, int32_t channel, int attempts) {
+  startJoin(index, bssid, channel);
+
+  for (int i = 0; i < attempts && WiFi.status() != WL_CONNECTED; i++) {
+    delay(500);
+    Serial.print(".");
+  }
+  Serial.println("");
+
+  if (WiFi.status() != WL_CONNECTED) {
+    if (networkFailures[index] < 255) networkFailures[index]++;
+    WiFi.disconnect();
+    return false;
+  }
+  networkFailures[index] = 0;
+  currentNetwork = index;
+  return true;
+}
+
+void startJoin(int index, const uint8_t* bssid, int32_t channel) {
+  Serial.print("Joining "); Serial.println(networkSsid(index));
+  if (index == 0 && config.useStaticIp) {
+    // No DHCP round trip; the address is only valid on the primary network
+    WiFi.config(IPAddress(config.staticIp), IPAddress(config.staticGateway),
+                IPAddress(config.staticNetmask), IPAddress(config.staticDns));
+  } else {
+    WiFi.config(IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0), IPAddress(0, 0, 0, 0));
+  }
+  WiFi.begin(networkSsid(index), networkPassword(index), channel, bssid);
+}
+
+void checkRoaming() {
+  if (roamJoining >= 0) return;
+  if (!roamScanRunning) {
+    if (millis() - lastRoamScanTime > roamScanInterval && WiFi.RSSI() < roamRssiThreshold) {
+      lastRoamScanTime = millis();
+      Serial.print("Weak signal ("); Serial.print(WiFi.RSSI()); Serial.println(" dBm), scanning for a better AP");
+      WiFi.scanNetworks(true);
+      roamScanRunning = true;
+    }
+    return;
+  }
+
+  int found = WiFi.scanComplete();
+  if (found == WIFI_SCAN_RUNNING) return;
+  roamScanRunning = false;
+  if (found < 0) return;
+
+  // Strongest known BSSID other than the one we are on
+  int32_t currentRssi = WiFi.RSSI();
+  uint8_t* currentBssid = WiFi.BSSID();
+  int bestIndex = -1;
+  int bestScan = -1;
+  int32_t bestRssi = currentRssi + roamHysteresis;
+  for (int j = 0; j < found; j++) {
+    if (WiFi.RSSI(j) < bestRssi) continue;
+    if (currentBssid != NULL && memcmp(WiFi.BSSID(j), currentBssid, 6) == 0) continue;
+    for (int i = 0; i < MAX_NETWORKS; i++) {
+      if (networkSsid(i)[0] != '\0' && WiFi.SSID(j) == networkSsid(i)) {
+        bestIndex = i;
+        bestScan = j;
+        bestRssi = WiFi.RSSI(j);
+        break;
+      }
+    }
+  }
+
+  if (bestIndex >= 0) {
+    uint8_t bssid[6];
+    memcpy(bssid, WiFi.BSSID(bestScan), sizeof(bssid));
+    int32_t channel = WiFi.channel(bestScan);
+    WiFi.scanDelete();
+    Serial.print("Roaming to "); Serial.print(networkSsid(bestIndex));
+    Serial.print(" ("); Serial.print(bestRssi); Serial.print(" dBm, was ");
+    Serial.print(currentRssi); Serial.println(" dBm)");
+    // The alert connection reconnects on its next use; sequence and state are kept.
+    // updateRoam() follows the join from the loop, so a press is never held up by it.
+    memcpy(roamBssid, bssid, sizeof(roamBssid));
+    roamHasBssid = true;
+    roamJoining = bestIndex;
+    roamFallback = currentNetwork;
+    roamStartTime = millis();
+    startJoin(bestIndex, bssid, channel);
+    return;
+  }
+  WiFi.scanDelete();
+}
+
+void updateRoam() {
+  if (roamJoining < 0) return;
+
+  // The old association may still report connected for a moment; wait for the new AP
+  bool joined = WiFi.status() == WL_CONNECTED &&
+                (!roamHasBssid || memcmp(WiFi.BSSID(), roamBssid, sizeof(roamBssid)) == 0);
+  if (joined) {
+    networkFailures[roamJoining] = 0;
+    currentNetwork = roamJoining;
+    lastWifiChannel = WiFi.channel();
+    Serial.print("Roamed to "); Serial.println(networkSsid(currentNetwork));
+    roamJoining = -1;
+    return;
+  }
+  if (millis() - roamStartTime < roamJoinTimeout) return;
+
+  if (networkFailures[roamJoining] < 255) networkFailures[roamJoining]++;
+  if (roamFallback >= 0) {
+    Serial.println("Roam failed, rejoining previous network");
+    roamJoining = roamFallback;
+    roamFallback = -1;
+    roamHasBssid = false;
+    roamStartTime = millis();
+    startJoin(roamJoining, NULL, 0);
+    return;
+  }
+  // Neither network came back; the regular reconnect with backoff takes over
+  Serial.println("Roam failed, falling back to reconnect");
+  roamJoining = -1;
+}
+
 void printNetworkInfo() {
   Serial.println("\n--- Network Diagnostics ---");
   Serial.print("WiFi Status: ");
@@ -523,10 +1964,28 @@ void networkDiagnostics() {
   } else {
     Serial.println("Not configured");
   }
+  Serial.print("Device ID: "); Serial.println(deviceId);
   Serial.print("Configured: "); Serial.println(config.configured ? "Yes" : "No");
   
   if (config.configured) {
     Serial.print("WiFi SSID: "); Serial.println(config.ssid);
+    for (int i = 0; i < MAX_EXTRA_NETWORKS; i++) {
+      if (config.networks[i].ssid[0] == '\0') continue;
+      Serial.print("Known network: "); Serial.println(config.networks[i].ssid);
+    }
+    if (config.useStaticIp) {
+      Serial.print("Static IP: "); Serial.println(IPAddress(config.staticIp));
+    }
+    if (config.pinnedServer[0] != '\0') {
+      Serial.print("Pinned server: "); Serial.print(config.pinnedServer);
+      Serial.print(":"); Serial.println(config.pinnedPort);
+    }
+    Serial.print("Transport: ");
+    if (config.transport == TRANSPORT_MQTT) {
+      Serial.print("MQTT "); Serial.print(config.mqttHost); Serial.print(":"); Serial.println(config.mqttPort);
+    } else {
+      Serial.println("HTTP");
+    }
     // Don't print the password for security
   }
   
@@ -0,0 +1,160 @@
+// Host tests for the binary alert frame (include/alert_frame.h).
+// Run with: pio test -e native
+
+#include <unity.h>
+#include "alert_frame.h"
+
+static AlertFrame sampleFrame() {
+  AlertFrame frame;
+  const uint8_t id[ALERT_FRAME_DEVICE_ID_SIZE] = {0x24, 0x6F, 0x28, 0xAB, 0xCD, 0xEF};
+  memcpy(frame.deviceId, id, sizeof(id));
+  frame.flags = ALERT_FRAME_FLAG_RETRY;
+  frame.bootId = 0xDEADBEEF;
+  frame.sequence = 0x01020304;
+  frame.state = 1;
+  frame.priority = 2;
+  frame.pressTimeMs = 0x0123456789ABCDEFULL;
+  frame.batteryMv = 3700;
+  frame.rssi = -61;
+  return frame;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_round_trip() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  AlertFrame in = sampleFrame();
+  size_t len = encodeAlertFrame(in, buffer, sizeof(buffer));
+  TEST_ASSERT_EQUAL(ALERT_FRAME_HEADER_SIZE, len);
+
+  AlertFrame out;
+  TEST_ASSERT_TRUE(decodeAlertFrame(buffer, len, out));
+  TEST_ASSERT_EQUAL_UINT8(ALERT_FRAME_TYPE_ALERT, out.type);
+  TEST_ASSERT_EQUAL_UINT8(ALERT_FRAME_FLAG_RETRY, out.flags);
+  TEST_ASSERT_EQUAL_UINT8_ARRAY(in.deviceId, out.deviceId, ALERT_FRAME_DEVICE_ID_SIZE);
+  TEST_ASSERT_EQUAL_UINT32(in.bootId, out.bootId);
+  TEST_ASSERT_EQUAL_UINT32(in.sequence, out.sequence);
+  TEST_ASSERT_EQUAL_UINT8(1, out.state);
+  TEST_ASSERT_EQUAL_UINT8(2, out.priority);
+  TEST_ASSERT_TRUE(in.pressTimeMs == out.pressTimeMs);
+  TEST_ASSERT_EQUAL_UINT16(3700, out.batteryMv);
+  TEST_ASSERT_EQUAL_INT8(-61, out.rssi);
+  TEST_ASSERT_EQUAL_UINT8(0, out.tlvLength);
+}
+
+void test_layout_is_little_endian() {
+  // The server parses these offsets directly, so they must not move
+  uint8_t buffer[ALERT_FRAME_HEADER_SIZE];
+  encodeAlertFrame(sampleFrame(), buffer, sizeof(buffer));
+  TEST_ASSERT_EQUAL_HEX8(ALERT_FRAME_MAGIC, buffer[0]);
+  TEST_ASSERT_EQUAL_HEX8(ALERT_FRAME_VERSION, buffer[1]);
+  const uint8_t sequence[] = {0x04, 0x03, 0x02, 0x01};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(sequence, buffer + 14, 4);
+  const uint8_t battery[] = {0x74, 0x0E};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(battery, buffer + 28, 2);
+  TEST_ASSERT_EQUAL_HEX8(0xEF, buffer[20]);
+  TEST_ASSERT_EQUAL_HEX8(0x01, buffer[27]);
+  TEST_ASSERT_EQUAL_HEX8((uint8_t)-61, buffer[30]);
+}
+
+void test_tlv_round_trip() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  size_t len = encodeAlertFrame(sampleFrame(), buffer, sizeof(buffer));
+  len = alertFrameAddTlv(buffer, sizeof(buffer), len, ALERT_TLV_DEVICE_NAME, "Lead", 4);
+  uint8_t hops = 1;
+  len = alertFrameAddTlv(buffer, sizeof(buffer), len, ALERT_TLV_HOP_COUNT, &hops, 1);
+  TEST_ASSERT_EQUAL(ALERT_FRAME_HEADER_SIZE + 6 + 3, len);
+
+  AlertFrame out;
+  TEST_ASSERT_TRUE(decodeAlertFrame(buffer, len, out));
+  AlertTlv tlv;
+  TEST_ASSERT_TRUE(alertFrameFindTlv(out, ALERT_TLV_DEVICE_NAME, tlv));
+  TEST_ASSERT_EQUAL_UINT8(4, tlv.length);
+  TEST_ASSERT_EQUAL_MEMORY("Lead", tlv.value, 4);
+  TEST_ASSERT_TRUE(alertFrameFindTlv(out, ALERT_TLV_HOP_COUNT, tlv));
+  TEST_ASSERT_EQUAL_UINT8(1, tlv.value[0]);
+}
+
+void test_unknown_tlv_is_skipped() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  size_t len = encodeAlertFrame(sampleFrame(), buffer, sizeof(buffer));
+  const uint8_t future[] = {9, 9, 9};
+  len = alertFrameAddTlv(buffer, sizeof(buffer), len, 200, future, sizeof(future));
+  len = alertFrameAddTlv(buffer, sizeof(buffer), len, ALERT_TLV_DEVICE_NAME, "A", 1);
+
+  AlertFrame out;
+  TEST_ASSERT_TRUE(decodeAlertFrame(buffer, len, out));
+  AlertTlv tlv;
+  TEST_ASSERT_TRUE(alertFrameFindTlv(out, ALERT_TLV_DEVICE_NAME, tlv));
+  TEST_ASSERT_EQUAL_CHAR('A', tlv.value[0]);
+  TEST_ASSERT_FALSE(alertFrameFindTlv(out, ALERT_TLV_HOP_COUNT, tlv));
+}
+
+void test_tlv_that_does_not_fit_leaves_frame_unchanged() {
+  uint8_t buffer[ALERT_FRAME_HEADER_SIZE + 4];
+  size_t len = encodeAlertFrame(sampleFrame(), buffer, sizeof(buffer));
+  TEST_ASSERT_EQUAL(0, alertFrameAddTlv(buffer, sizeof(buffer), len, ALERT_TLV_DEVICE_NAME, "Lead", 4));
+  TEST_ASSERT_EQUAL_UINT8(0, buffer[ALERT_FRAME_OFFSET_TLV_LENGTH]);
+
+  uint8_t small[ALERT_FRAME_HEADER_SIZE - 1];
+  TEST_ASSERT_EQUAL(0, encodeAlertFrame(sampleFrame(), small, sizeof(small)));
+}
+
+void test_truncated_frames_are_rejected() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  size_t len = encodeAlertFrame(sampleFrame(), buffer, sizeof(buffer));
+  len = alertFrameAddTlv(buffer, sizeof(buffer), len, ALERT_TLV_DEVICE_NAME, "Lead", 4);
+
+  AlertFrame out;
+  for (size_t cut = 0; cut < len; cut++) {
+    TEST_ASSERT_FALSE(decodeAlertFrame(buffer, cut, out));
+  }
+  TEST_ASSERT_TRUE(decodeAlertFrame(buffer, len, out));
+}
+
+void test_wrong_magic_and_versions_are_rejected() {
+  uint8_t buffer[ALERT_FRAME_HEADER_SIZE];
+  AlertFrame out;
+
+  encodeAlertFrame(sampleFrame(), buffer, sizeof(buffer));
+  buffer[ALERT_FRAME_OFFSET_MAGIC] = 'W'; // Start of a WHERE_IS_SERVER request
+  TEST_ASSERT_FALSE(decodeAlertFrame(buffer, sizeof(buffer), out));
+
+  encodeAlertFrame(sampleFrame(), buffer, sizeof(buffer));
+  buffer[ALERT_FRAME_OFFSET_VERSION] = ALERT_FRAME_VERSION + 1;
+  TEST_ASSERT_FALSE(decodeAlertFrame(buffer, sizeof(buffer), out));
+
+  buffer[ALERT_FRAME_OFFSET_VERSION] = 0;
+  TEST_ASSERT_FALSE(decodeAlertFrame(buffer, sizeof(buffer), out));
+}
+
+void test_malformed_tlv_area_is_rejected() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  size_t len = encodeAlertFrame(sampleFrame(), buffer, sizeof(buffer));
+  len = alertFrameAddTlv(buffer, sizeof(buffer), len, ALERT_TLV_DEVICE_NAME, "Lead", 4);
+  AlertFrame out;
+
+  // A value length running past the TLV area
+  buffer[ALERT_FRAME_HEADER_SIZE + 1] = 5;
+  TEST_ASSERT_FALSE(decodeAlertFrame(buffer, len, out));
+
+  // A TLV area ending inside a type/length pair
+  buffer[ALERT_FRAME_HEADER_SIZE + 1] = 4;
+  buffer[len] = ALERT_TLV_HOP_COUNT;
+  buffer[ALERT_FRAME_OFFSET_TLV_LENGTH] = 7;
+  TEST_ASSERT_FALSE(decodeAlertFrame(buffer, len + 1, out));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_round_trip);
+  RUN_TEST(test_layout_is_little_endian);
+  RUN_TEST(test_tlv_round_trip);
+  RUN_TEST(test_unknown_tlv_is_skipped);
+  RUN_TEST(test_tlv_that_does_not_fit_leaves_frame_unchanged);
+  RUN_TEST(test_truncated_frames_are_rejected);
+  RUN_TEST(test_wrong_magic_and_versions_are_rejected);
+  RUN_TEST(test_malformed_tlv_area_is_rejected);
+  return UNITY_END();
+}
@@ -0,0 +1,208 @@
+// Host tests for the text protocol (include/alert_protocol.h): the alert form
+// body, the heartbeat line and the control message parser.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include "alert_protocol.h"
+
+static const char* DEVICE = "246F28ABCDEF";
+
+static AlertFormFields sampleFields() {
+  AlertFormFields fields;
+  fields.name = "Lead Vocal";
+  fields.device = DEVICE;
+  fields.bootId = 4000000000UL;
+  fields.sequence = 17;
+  fields.state = true;
+  return fields;
+}
+
+static bool parse(const char* text, ControlMessage& message) {
+  return parseControlMessage(text, DEVICE, message);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_form_body() {
+  char body[ALERT_FORM_MAX];
+  size_t len = buildAlertForm(body, sizeof(body), sampleFields());
+  TEST_ASSERT_EQUAL_STRING("name=Lead+Vocal&device=246F28ABCDEF&boot=4000000000&seq=17&state=1", body);
+  TEST_ASSERT_EQUAL(strlen(body), len);
+}
+
+void test_form_optional_fields() {
+  AlertFormFields fields = sampleFields();
+  fields.state = false;
+  fields.pressTimeMs = 1700000000123ULL;
+  fields.hops = 2;
+  fields.via = "AABBCCDDEEFF";
+  char body[ALERT_FORM_MAX];
+  buildAlertForm(body, sizeof(body), fields);
+  TEST_ASSERT_EQUAL_STRING("name=Lead+Vocal&device=246F28ABCDEF&boot=4000000000&seq=17&state=0"
+                           "&press=1700000000123&hops=2&via=AABBCCDDEEFF", body);
+}
+
+void test_form_name_is_escaped() {
+  AlertFormFields fields = sampleFields();
+  fields.name = "A&B=C%\xC3\xA9";
+  char body[ALERT_FORM_MAX];
+  buildAlertForm(body, sizeof(body), fields);
+  // A name cannot inject a field of its own
+  TEST_ASSERT_EQUAL_STRING("name=A%26B%3DC%25%C3%A9&device=246F28ABCDEF&boot=4000000000&seq=17&state=1", body);
+}
+
+void test_form_longest_body_fits() {
+  // The device name field holds 31 characters; every one may need escaping
+  char name[32];
+  memset(name, '&', 31);
+  name[31] = '\0';
+  AlertFormFields fields = sampleFields();
+  fields.name = name;
+  fields.bootId = UINT32_MAX;
+  fields.sequence = UINT32_MAX;
+  fields.pressTimeMs = UINT64_MAX;
+  fields.hops = 255;
+  fields.via = "AABBCCDDEEFF";
+  char body[ALERT_FORM_MAX];
+  size_t len = buildAlertForm(body, sizeof(body), fields);
+  TEST_ASSERT_TRUE(len > 0);
+  TEST_ASSERT_TRUE(len < ALERT_FORM_MAX);
+}
+
+void test_form_that_does_not_fit_is_not_sent_cut_off() {
+  char body[ALERT_FORM_MAX];
+  AlertFormFields fields = sampleFields();
+  size_t full = buildAlertForm(body, sizeof(body), fields);
+
+  for (size_t cap = 0; cap <= full; cap++) {
+    char small[ALERT_FORM_MAX];
+    memset(small, 'x', sizeof(small));
+    TEST_ASSERT_EQUAL(0, buildAlertForm(small, cap, fields));
+    if (cap > 0) TEST_ASSERT_EQUAL_CHAR('\0', small[0]);
+  }
+  TEST_ASSERT_EQUAL(full, buildAlertForm(body, full + 1, fields));
+}
+
+void test_form_encoding_never_splits_an_escape() {
+  char out[8];
+  size_t len = appendFormEncoded(out, sizeof(out), 0, "a&b&c");
+  // "a%26b" is 5, "%26" would need 3 more plus the terminator
+  TEST_ASSERT_EQUAL_STRING("a%26b", out);
+  TEST_ASSERT_EQUAL(5, len);
+  TEST_ASSERT_EQUAL(formEncodedLength("a&b&c"), 9);
+}
+
+void test_heartbeat() {
+  char packet[HEARTBEAT_MAX];
+  size_t len = buildHeartbeat(packet, sizeof(packet), DEVICE, 12345, true, 987654321ULL, "Lead Vocal");
+  TEST_ASSERT_EQUAL_STRING("HEARTBEAT 246F28ABCDEF 12345 1 987654321 Lead Vocal", packet);
+  TEST_ASSERT_EQUAL(strlen(packet), len);
+}
+
+void test_heartbeat_long_name_is_cut_not_the_fields() {
+  char name[200];
+  memset(name, 'n', sizeof(name) - 1);
+  name[sizeof(name) - 1] = '\0';
+  char packet[HEARTBEAT_MAX];
+  size_t len = buildHeartbeat(packet, sizeof(packet), DEVICE, UINT32_MAX, false, UINT64_MAX, name);
+  TEST_ASSERT_EQUAL(HEARTBEAT_MAX - 1, len);
+  TEST_ASSERT_EQUAL(len, strlen(packet));
+  TEST_ASSERT_EQUAL_MEMORY("HEARTBEAT 246F28ABCDEF 4294967295 0 18446744073709551615 n", packet, 57);
+}
+
+void test_heartbeat_name_cannot_break_the_line() {
+  char packet[HEARTBEAT_MAX];
+  buildHeartbeat(packet, sizeof(packet), DEVICE, 1, false, 2, "A\nB\rC");
+  TEST_ASSERT_EQUAL_STRING("HEARTBEAT 246F28ABCDEF 1 0 2 A B C", packet);
+}
+
+void test_heartbeat_too_small() {
+  char packet[16];
+  memset(packet, 'x', sizeof(packet));
+  TEST_ASSERT_EQUAL(0, buildHeartbeat(packet, sizeof(packet), DEVICE, 1, false, 2, "A"));
+  TEST_ASSERT_EQUAL_CHAR('\0', packet[0]);
+}
+
+void test_control_messages() {
+  ControlMessage message;
+  TEST_ASSERT_TRUE(parse("ACK 246F28ABCDEF 17", message));
+  TEST_ASSERT_EQUAL(CONTROL_TYPE_ACK, message.type);
+  TEST_ASSERT_EQUAL_UINT32(17, message.sequence);
+
+  TEST_ASSERT_TRUE(parse("CLEAR 246F28ABCDEF 4294967295", message));
+  TEST_ASSERT_EQUAL(CONTROL_TYPE_CLEAR, message.type);
+  TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, message.sequence);
+
+  TEST_ASSERT_TRUE(parse("TIME 246F28ABCDEF 1000 1700000000000 18446744073709551615", message));
+  TEST_ASSERT_EQUAL(CONTROL_TYPE_TIME, message.type);
+  TEST_ASSERT_TRUE(message.t0 == 1000);
+  TEST_ASSERT_TRUE(message.t1 == 1700000000000ULL);
+  TEST_ASSERT_TRUE(message.t2 == UINT64_MAX);
+
+  TEST_ASSERT_TRUE(parse("INTERVAL 246F28ABCDEF 0", message));
+  TEST_ASSERT_EQUAL(CONTROL_TYPE_INTERVAL, message.type);
+  TEST_ASSERT_EQUAL_UINT32(0, message.intervalMs);
+}
+
+void test_control_separators_and_extra_fields() {
+  ControlMessage message;
+  TEST_ASSERT_TRUE(parse("ACK  246F28ABCDEF\t17\r\n", message));
+  TEST_ASSERT_EQUAL_UINT32(17, message.sequence);
+  // Newer servers may append fields
+  TEST_ASSERT_TRUE(parse("ACK 246F28ABCDEF 17 crew=FOH", message));
+}
+
+void test_control_for_another_device() {
+  ControlMessage message;
+  TEST_ASSERT_FALSE(parse("ACK 246F28ABCDE0 17", message));
+  TEST_ASSERT_FALSE(parse("ACK 246F28ABCDE 17", message));
+  TEST_ASSERT_FALSE(parse("ACK 246F28ABCDEF0 17", message)); // Too long for an ID
+  TEST_ASSERT_FALSE(parse("ACK 246f28abcdef 17", message));
+}
+
+void test_control_unknown_or_oversized_command() {
+  ControlMessage message;
+  TEST_ASSERT_FALSE(parse("ack 246F28ABCDEF 17", message));
+  TEST_ASSERT_FALSE(parse("RESET 246F28ABCDEF", message));
+  TEST_ASSERT_FALSE(parse("INTERVALS 246F28ABCDEF 1000", message));
+  TEST_ASSERT_FALSE(parse("ACK246F28ABCDEF 17", message));
+  TEST_ASSERT_FALSE(parse("", message));
+  TEST_ASSERT_FALSE(parse("   \r\n", message));
+  TEST_ASSERT_FALSE(parse("WHERE_IS_SERVER", message));
+}
+
+void test_control_malformed_numbers() {
+  ControlMessage message;
+  TEST_ASSERT_FALSE(parse("ACK 246F28ABCDEF", message));
+  TEST_ASSERT_FALSE(parse("ACK 246F28ABCDEF -1", message));
+  TEST_ASSERT_FALSE(parse("ACK 246F28ABCDEF +5", message));
+  TEST_ASSERT_FALSE(parse("ACK 246F28ABCDEF 12abc", message));
+  TEST_ASSERT_FALSE(parse("ACK 246F28ABCDEF 0x10", message));
+  TEST_ASSERT_FALSE(parse("CLEAR 246F28ABCDEF", message));
+  TEST_ASSERT_FALSE(parse("CLEAR 246F28ABCDEF 4294967296", message));
+  TEST_ASSERT_FALSE(parse("INTERVAL 246F28ABCDEF 99999999999", message));
+  TEST_ASSERT_FALSE(parse("TIME 246F28ABCDEF 1 2", message));
+  TEST_ASSERT_FALSE(parse("TIME 246F28ABCDEF 1 2 18446744073709551616", message));
+  TEST_ASSERT_FALSE(parse("TIME 246F28ABCDEF 1 2 3.5", message));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_form_body);
+  RUN_TEST(test_form_optional_fields);
+  RUN_TEST(test_form_name_is_escaped);
+  RUN_TEST(test_form_longest_body_fits);
+  RUN_TEST(test_form_that_does_not_fit_is_not_sent_cut_off);
+  RUN_TEST(test_form_encoding_never_splits_an_escape);
+  RUN_TEST(test_heartbeat);
+  RUN_TEST(test_heartbeat_long_name_is_cut_not_the_fields);
+  RUN_TEST(test_heartbeat_name_cannot_break_the_line);
+  RUN_TEST(test_heartbeat_too_small);
+  RUN_TEST(test_control_messages);
+  RUN_TEST(test_control_separators_and_extra_fields);
+  RUN_TEST(test_control_for_another_device);
+  RUN_TEST(test_control_unknown_or_oversized_command);
+  RUN_TEST(test_control_malformed_numbers);
+  return UNITY_END();
+}
@@ -0,0 +1,615 @@
+// Host tests for the ESP-NOW relay rules (include/alert_relay.h) and the origin's
+// pending alert (include/alert_origin.h), including a small fleet simulation over
+// a configurable connectivity graph.
+// Run with: pio test -e native
+
+#include <unity.h>
+#include "alert_origin.h"
+
+static size_t makeAlert(uint8_t* buffer, uint8_t device, uint32_t sequence, int hops = -1) {
+  AlertFrame frame;
+  frame.deviceId[5] = device;
+  frame.bootId = 42;
+  frame.sequence = sequence;
+  frame.state = 1;
+  size_t len = encodeAlertFrame(frame, buffer, ALERT_FRAME_MAX_SIZE);
+  if (hops >= 0) {
+    uint8_t value = (uint8_t)hops;
+    len = alertFrameAddTlv(buffer, ALERT_FRAME_MAX_SIZE, len, ALERT_TLV_HOP_COUNT, &value, 1);
+  }
+  return len;
+}
+
+static size_t makeAck(uint8_t* buffer, const AlertFrame& alert) {
+  AlertFrame ack;
+  ack.type = ALERT_FRAME_TYPE_ACK;
+  memcpy(ack.deviceId, alert.deviceId, sizeof(ack.deviceId));
+  ack.bootId = alert.bootId;
+  ack.sequence = alert.sequence;
+  return encodeAlertFrame(ack, buffer, ALERT_FRAME_MAX_SIZE);
+}
+
+static AlertFrame decoded(const uint8_t* buffer, size_t len) {
+  AlertFrame frame;
+  TEST_ASSERT_TRUE(decodeAlertFrame(buffer, len, frame));
+  return frame;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_online_device_delivers_once() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  size_t len = makeAlert(buffer, 1, 7);
+  AlertFrame frame = decoded(buffer, len);
+
+  TEST_ASSERT_EQUAL(RELAY_HOLD, relayDecide(table, frame, true, true));
+  TEST_ASSERT_TRUE(relayHold(table, buffer, len, 1100));
+  // The origin's retry during the holdoff
+  TEST_ASSERT_EQUAL(RELAY_IGNORE, relayDecide(table, frame, true, true));
+
+  RelayHeld held;
+  TEST_ASSERT_FALSE(relayTakeDue(table, 1099, held));
+  TEST_ASSERT_TRUE(relayTakeDue(table, 1100, held));
+  TEST_ASSERT_EQUAL(len, held.len);
+  TEST_ASSERT_EQUAL_MEMORY(buffer, held.data, len);
+  TEST_ASSERT_FALSE(relayTakeDue(table, 2000, held));
+
+  relayMarkDelivered(table, frame);
+  // The origin retried because it missed the ACK
+  TEST_ASSERT_EQUAL(RELAY_REPEAT_ACK, relayDecide(table, frame, true, true));
+}
+
+void test_failed_delivery_is_retried() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  size_t len = makeAlert(buffer, 1, 7);
+  AlertFrame frame = decoded(buffer, len);
+
+  TEST_ASSERT_EQUAL(RELAY_HOLD, relayDecide(table, frame, true, true));
+  TEST_ASSERT_TRUE(relayHold(table, buffer, len, 1000));
+  RelayHeld held;
+  TEST_ASSERT_TRUE(relayTakeDue(table, 1000, held));
+  // The POST failed, so nothing was marked delivered
+  TEST_ASSERT_EQUAL(RELAY_HOLD, relayDecide(table, frame, true, true));
+}
+
+void test_overheard_ack_cancels_the_holdoff() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  uint8_t ackBuffer[ALERT_FRAME_MAX_SIZE];
+  size_t len = makeAlert(buffer, 1, 7);
+  AlertFrame frame = decoded(buffer, len);
+  AlertFrame ack = decoded(ackBuffer, makeAck(ackBuffer, frame));
+
+  TEST_ASSERT_EQUAL(RELAY_HOLD, relayDecide(table, frame, true, true));
+  TEST_ASSERT_TRUE(relayHold(table, buffer, len, 1100));
+  // Another relay posted first
+  TEST_ASSERT_EQUAL(RELAY_IGNORE, relayDecide(table, ack, true, true));
+  RelayHeld held;
+  TEST_ASSERT_FALSE(relayTakeDue(table, 5000, held));
+  // The origin missed that ACK; answer for the other relay
+  TEST_ASSERT_EQUAL(RELAY_REPEAT_ACK, relayDecide(table, frame, true, true));
+}
+
+void test_ack_for_another_alert_keeps_the_hold() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  uint8_t other[ALERT_FRAME_MAX_SIZE];
+  uint8_t ackBuffer[ALERT_FRAME_MAX_SIZE];
+  size_t len = makeAlert(buffer, 1, 7);
+  AlertFrame frame = decoded(buffer, len);
+  AlertFrame previous = decoded(other, makeAlert(other, 1, 6));
+  relayDecide(table, previous, false, false);
+
+  TEST_ASSERT_EQUAL(RELAY_HOLD, relayDecide(table, frame, true, true));
+  TEST_ASSERT_TRUE(relayHold(table, buffer, len, 1100));
+  relayDecide(table, decoded(ackBuffer, makeAck(ackBuffer, previous)), true, true);
+  RelayHeld held;
+  TEST_ASSERT_TRUE(relayTakeDue(table, 1100, held));
+}
+
+void test_delivers_at_once_when_no_room_to_hold() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  for (uint32_t sequence = 0; sequence < RELAY_HELD; sequence++) {
+    size_t len = makeAlert(buffer, 1, sequence);
+    TEST_ASSERT_EQUAL(RELAY_HOLD, relayDecide(table, decoded(buffer, len), true, true));
+    TEST_ASSERT_TRUE(relayHold(table, buffer, len, 1000));
+  }
+  size_t len = makeAlert(buffer, 1, RELAY_HELD);
+  TEST_ASSERT_FALSE(relayHold(table, buffer, len, 1000));
+  TEST_ASSERT_EQUAL(RELAY_DELIVER, relayDecide(table, decoded(buffer, len), true, true));
+}
+
+void test_dedup_key_is_device_boot_and_sequence() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  AlertFrame first = decoded(buffer, makeAlert(buffer, 1, 7));
+  relayDecide(table, first, true, true);
+  relayMarkDelivered(table, first);
+
+  uint8_t other[ALERT_FRAME_MAX_SIZE];
+  AlertFrame nextPress = decoded(other, makeAlert(other, 1, 8));
+  TEST_ASSERT_EQUAL(RELAY_HOLD, relayDecide(table, nextPress, true, true));
+
+  AlertFrame otherDevice = decoded(other, makeAlert(other, 2, 7));
+  TEST_ASSERT_EQUAL(RELAY_HOLD, relayDecide(table, otherDevice, true, true));
+
+  AlertFrame rebooted = decoded(other, makeAlert(other, 1, 7));
+  rebooted.bootId = 43;
+  TEST_ASSERT_EQUAL(RELAY_HOLD, relayDecide(table, rebooted, true, true));
+}
+
+void test_offline_device_rebroadcasts_once() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  AlertFrame frame = decoded(buffer, makeAlert(buffer, 1, 7));
+
+  TEST_ASSERT_EQUAL(RELAY_REBROADCAST, relayDecide(table, frame, false, true));
+  TEST_ASSERT_EQUAL(RELAY_IGNORE, relayDecide(table, frame, false, true));
+}
+
+void test_no_rebroadcast_without_radio_channel() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  AlertFrame frame = decoded(buffer, makeAlert(buffer, 1, 7));
+
+  TEST_ASSERT_EQUAL(RELAY_IGNORE, relayDecide(table, frame, false, false));
+  // Not recorded as sent, so a retry after the channel is known still goes out
+  TEST_ASSERT_EQUAL(RELAY_REBROADCAST, relayDecide(table, frame, false, true));
+}
+
+void test_hop_limit() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  AlertFrame lastHop = decoded(buffer, makeAlert(buffer, 1, 7, RELAY_MAX_HOPS));
+  TEST_ASSERT_EQUAL(RELAY_IGNORE, relayDecide(table, lastHop, false, true));
+  // An online device still delivers it
+  TEST_ASSERT_EQUAL(RELAY_HOLD, relayDecide(table, lastHop, true, true));
+}
+
+void test_increment_hops() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  size_t len = makeAlert(buffer, 1, 7);
+  AlertFrame frame = decoded(buffer, len);
+  TEST_ASSERT_EQUAL_UINT8(0, alertFrameHops(frame));
+
+  len = alertFrameIncrementHops(buffer, sizeof(buffer), len, frame);
+  frame = decoded(buffer, len);
+  TEST_ASSERT_EQUAL_UINT8(1, alertFrameHops(frame));
+
+  size_t same = alertFrameIncrementHops(buffer, sizeof(buffer), len, frame);
+  TEST_ASSERT_EQUAL(len, same);
+  TEST_ASSERT_EQUAL_UINT8(2, alertFrameHops(decoded(buffer, same)));
+}
+
+void test_ack_forwarded_only_for_own_rebroadcast() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  uint8_t ackBuffer[ALERT_FRAME_MAX_SIZE];
+  AlertFrame alert = decoded(buffer, makeAlert(buffer, 1, 7));
+  AlertFrame ack = decoded(ackBuffer, makeAck(ackBuffer, alert));
+
+  // Never heard the alert
+  TEST_ASSERT_EQUAL(RELAY_IGNORE, relayDecide(table, ack, false, true));
+
+  TEST_ASSERT_EQUAL(RELAY_REBROADCAST, relayDecide(table, alert, false, true));
+  TEST_ASSERT_EQUAL(RELAY_FORWARD_ACK, relayDecide(table, ack, false, true));
+  TEST_ASSERT_EQUAL(RELAY_IGNORE, relayDecide(table, ack, false, true));
+}
+
+void test_ack_matching() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  uint8_t ackBuffer[ALERT_FRAME_MAX_SIZE];
+  AlertFrame alert = decoded(buffer, makeAlert(buffer, 1, 7));
+  AlertFrame ack = decoded(ackBuffer, makeAck(ackBuffer, alert));
+
+  TEST_ASSERT_TRUE(alertFrameAcks(ack, alert.deviceId, 42, 7));
+  TEST_ASSERT_FALSE(alertFrameAcks(ack, alert.deviceId, 42, 6));
+  TEST_ASSERT_FALSE(alertFrameAcks(ack, alert.deviceId, 41, 7));
+  uint8_t otherDevice[ALERT_FRAME_DEVICE_ID_SIZE] = {0, 0, 0, 0, 0, 2};
+  TEST_ASSERT_FALSE(alertFrameAcks(ack, otherDevice, 42, 7));
+  // The alert itself is not an ACK
+  TEST_ASSERT_FALSE(alertFrameAcks(alert, alert.deviceId, 42, 7));
+}
+
+void test_history_forgets_oldest() {
+  RelayTable table;
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  AlertFrame first = decoded(buffer, makeAlert(buffer, 1, 0));
+  relayDecide(table, first, false, true);
+
+  for (uint32_t sequence = 1; sequence < RELAY_HISTORY; sequence++) {
+    uint8_t other[ALERT_FRAME_MAX_SIZE];
+    relayDecide(table, decoded(other, makeAlert(other, 1, sequence)), false, true);
+  }
+  TEST_ASSERT_NOT_NULL(relayFind(table, first));
+
+  uint8_t other[ALERT_FRAME_MAX_SIZE];
+  relayDecide(table, decoded(other, makeAlert(other, 1, RELAY_HISTORY)), false, true);
+  TEST_ASSERT_NULL(relayFind(table, first));
+}
+
+void test_origin_pending_until_acked() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  uint8_t ackBuffer[ALERT_FRAME_MAX_SIZE];
+  size_t len = makeAlert(buffer, 1, 7);
+  AlertFrame alert = decoded(buffer, len);
+  OriginAlert origin;
+  TEST_ASSERT_TRUE(originStart(origin, buffer, len, 1000));
+  TEST_ASSERT_TRUE(origin.pending);
+
+  // Our own frame echoed back by a relay is not an ACK
+  TEST_ASSERT_FALSE(originHandleAck(origin, alert));
+  TEST_ASSERT_TRUE(originHandleAck(origin, decoded(ackBuffer, makeAck(ackBuffer, alert))));
+  TEST_ASSERT_FALSE(origin.pending);
+  // A second relay's ACK for the same press
+  TEST_ASSERT_FALSE(originHandleAck(origin, decoded(ackBuffer, makeAck(ackBuffer, alert))));
+  TEST_ASSERT_FALSE(originRetryDue(origin, 100000));
+}
+
+void test_origin_ignores_ack_for_older_press() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  uint8_t ackBuffer[ALERT_FRAME_MAX_SIZE];
+  AlertFrame older = decoded(buffer, makeAlert(buffer, 1, 7));
+  AlertFrame olderAck = decoded(ackBuffer, makeAck(ackBuffer, older));
+
+  OriginAlert origin;
+  TEST_ASSERT_TRUE(originStart(origin, buffer, makeAlert(buffer, 1, 8), 1000));
+  TEST_ASSERT_FALSE(originHandleAck(origin, olderAck));
+  AlertFrame otherDevice = decoded(buffer, makeAlert(buffer, 2, 8));
+  TEST_ASSERT_FALSE(originHandleAck(origin, decoded(ackBuffer, makeAck(ackBuffer, otherDevice))));
+  TEST_ASSERT_TRUE(origin.pending);
+}
+
+void test_origin_retry_backoff() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  OriginAlert origin;
+  TEST_ASSERT_TRUE(originStart(origin, buffer, makeAlert(buffer, 1, 7), 1000));
+  TEST_ASSERT_FALSE(originRetryDue(origin, 1000 + ORIGIN_RETRY_INTERVAL));
+  TEST_ASSERT_TRUE(originRetryDue(origin, 1000 + ORIGIN_RETRY_INTERVAL + 1));
+
+  originRetried(origin, 1300);
+  TEST_ASSERT_EQUAL_UINT32(2 * ORIGIN_RETRY_INTERVAL, origin.backoffMs);
+  TEST_ASSERT_TRUE(decoded(origin.frame, origin.length).flags & ALERT_FRAME_FLAG_RETRY);
+  for (int i = 0; i < 10; i++) originRetried(origin, 1300);
+  TEST_ASSERT_EQUAL_UINT32(ORIGIN_RETRY_CAP, origin.backoffMs);
+
+  // A new press starts over
+  TEST_ASSERT_TRUE(originStart(origin, buffer, makeAlert(buffer, 1, 8), 2000));
+  TEST_ASSERT_EQUAL_UINT32(ORIGIN_RETRY_INTERVAL, origin.backoffMs);
+  TEST_ASSERT_FALSE(decoded(origin.frame, origin.length).flags & ALERT_FRAME_FLAG_RETRY);
+}
+
+void test_origin_rejects_non_alert() {
+  uint8_t buffer[ALERT_FRAME_MAX_SIZE];
+  uint8_t ackBuffer[ALERT_FRAME_MAX_SIZE];
+  AlertFrame alert = decoded(buffer, makeAlert(buffer, 1, 7));
+  OriginAlert origin;
+  TEST_ASSERT_FALSE(originStart(origin, ackBuffer, makeAck(ackBuffer, alert), 1000));
+  buffer[ALERT_FRAME_OFFSET_MAGIC] = 0;
+  TEST_ASSERT_FALSE(originStart(origin, buffer, ALERT_FRAME_HEADER_SIZE, 1000));
+  TEST_ASSERT_FALSE(origin.pending);
+}
+
+// Fleet simulation: node 0 is the origin, a broadcast reaches every node linked
+// to the sender, and online nodes post to the server once their holdoff runs
+// out and answer with an ACK. Broadcasts arrive at once and a POST takes no
+// time. While no ACK has come back the origin re-sends its frame, up to
+// originRetries times; lateOnline nodes get their uplink back before the first retry.
+const int SIM_NODES = 6;
+
+struct SimFleet {
+  bool link[SIM_NODES][SIM_NODES] = {};
+  bool online[SIM_NODES] = {};
+  bool lateOnline[SIM_NODES] = {};
+  unsigned long holdoffMs[SIM_NODES];
+  RelayTable tables[SIM_NODES];
+  int originRetries = 0;
+  int originSends = 0;
+  int deliveries = 0;
+  int maxDeliveredHops = -1;
+  bool deliveredRetry = false;
+  bool originAcked = false;
+
+  SimFleet() {
+    // Stands in for the random holdoff; distinct per node
+    for (int node = 0; node < SIM_NODES; node++) holdoffMs[node] = 20 * node;
+  }
+
+  void connect(int a, int b) {
+    link[a][b] = true;
+    link[b][a] = true;
+  }
+};
+
+struct SimMessage {
+  int to;
+  uint8_t data[ALERT_FRAME_MAX_SIZE];
+  size_t len;
+};
+
+static void runFleet(SimFleet& fleet) {
+  static SimMessage queue[256];
+  int head = 0;
+  int tail = 0;
+  auto broadcast = [&](int from, const uint8_t* data, size_t len) {
+    for (int to = 0; to < SIM_NODES; to++) {
+      if (to == from || !fleet.link[from][to]) continue;
+      TEST_ASSERT_TRUE(tail < 256);
+      queue[tail].to = to;
+      memcpy(queue[tail].data, data, len);
+      queue[tail].len = len;
+      tail++;
+    }
+  };
+
+  unsigned long now = 0;
+  auto deliver = [&](int node, const AlertFrame& frame) {
+    fleet.deliveries++;
+    int hops = alertFrameHops(frame) + 1;
+    if (hops > fleet.maxDeliveredHops) fleet.maxDeliveredHops = hops;
+    if (frame.flags & ALERT_FRAME_FLAG_RETRY) fleet.deliveredRetry = true;
+    relayMarkDelivered(fleet.tables[node], frame);
+    uint8_t ack[ALERT_FRAME_MAX_SIZE];
+    broadcast(node, ack, makeAck(ack, frame));
+  };
+
+  OriginAlert origin;
+  uint8_t alert[ALERT_FRAME_MAX_SIZE];
+  TEST_ASSERT_TRUE(originStart(origin, alert, makeAlert(alert, 0, 1), now));
+  broadcast(0, origin.frame, origin.length);
+  fleet.originSends++;
+
+  int retries = 0;
+  for (;;) {
+    while (head < tail) {
+      SimMessage& message = queue[head++];
+      AlertFrame frame = decoded(message.data, message.len);
+      int node = message.to;
+
+      if (node == 0) {
+        if (originHandleAck(origin, frame)) fleet.originAcked = true;
+        continue;
+      }
+
+      switch (relayDecide(fleet.tables[node], frame, fleet.online[node], true)) {
+        case RELAY_HOLD:
+          TEST_ASSERT_TRUE(relayHold(fleet.tables[node], message.data, message.len, now + fleet.holdoffMs[node]));
+          break;
+        case RELAY_DELIVER:
+          deliver(node, frame);
+          break;
+        case RELAY_REPEAT_ACK: {
+          uint8_t ack[ALERT_FRAME_MAX_SIZE];
+          broadcast(node, ack, makeAck(ack, frame));
+          break;
+        }
+        case RELAY_REBROADCAST: {
+          size_t len = alertFrameIncrementHops(message.data, sizeof(message.data), message.len, frame);
+          TEST_ASSERT_TRUE(len > 0);
+          broadcast(node, message.data, len);
+          break;
+        }
+        case RELAY_FORWARD_ACK:
+          broadcast(node, message.data, message.len);
+          break;
+        case RELAY_IGNORE:
+          break;
+      }
+    }
+
+    // Next event: the earliest holdoff to run out. Every node due at that moment
+    // posts before any of them hears another's ACK.
+    bool held = false;
+    unsigned long dueAt = 0;
+    for (int node = 0; node < SIM_NODES; node++) {
+      for (const RelayHeld& slot : fleet.tables[node].held) {
+        if (slot.used && (!held || slot.deliverAtMs < dueAt)) dueAt = slot.deliverAtMs;
+        held = held || slot.used;
+      }
+    }
+    if (held) {
+      if (dueAt > now) now = dueAt;
+      for (int node = 0; node < SIM_NODES; node++) {
+        RelayHeld slot;
+        while (relayTakeDue(fleet.tables[node], now, slot)) deliver(node, decoded(slot.data, slot.len));
+      }
+      continue;
+    }
+    if (!origin.pending || retries == fleet.originRetries) break;
+
+    // Nothing came back; the origin re-sends once its backoff runs out
+    for (int node = 0; node < SIM_NODES; node++) {
+      if (fleet.lateOnline[node]) fleet.online[node] = true;
+    }
+    now += origin.retryDelayMs + 1;
+    TEST_ASSERT_TRUE(originRetryDue(origin, now));
+    originRetried(origin, now);
+    broadcast(0, origin.frame, origin.length);
+    fleet.originSends++;
+    retries++;
+  }
+  TEST_ASSERT_EQUAL(fleet.originAcked, !origin.pending);
+}
+
+void test_fleet_one_hop_to_online_neighbour() {
+  SimFleet fleet;
+  fleet.connect(0, 1);
+  fleet.online[1] = true;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(1, fleet.deliveries);
+  TEST_ASSERT_EQUAL(1, fleet.maxDeliveredHops);
+  TEST_ASSERT_TRUE(fleet.originAcked);
+}
+
+void test_fleet_chain_through_offline_neighbours() {
+  // 0 - 1 - 2 - 3, only 3 online: two re-broadcasts, the ACK comes back the same way
+  SimFleet fleet;
+  fleet.connect(0, 1);
+  fleet.connect(1, 2);
+  fleet.connect(2, 3);
+  fleet.online[3] = true;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(1, fleet.deliveries);
+  TEST_ASSERT_EQUAL(3, fleet.maxDeliveredHops);
+  TEST_ASSERT_TRUE(fleet.originAcked);
+}
+
+void test_fleet_beyond_hop_limit() {
+  // 0 - 1 - 2 - 3 - 4, only 4 online: node 3 may not re-broadcast a third time
+  SimFleet fleet;
+  fleet.connect(0, 1);
+  fleet.connect(1, 2);
+  fleet.connect(2, 3);
+  fleet.connect(3, 4);
+  fleet.online[4] = true;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(0, fleet.deliveries);
+  TEST_ASSERT_FALSE(fleet.originAcked);
+}
+
+void test_fleet_mesh_loop_is_deduplicated() {
+  // Offline nodes 1-4 hear each other; each re-broadcasts at most once
+  SimFleet fleet;
+  fleet.connect(0, 1);
+  fleet.connect(0, 2);
+  for (int a = 1; a <= 4; a++) {
+    for (int b = a + 1; b <= 4; b++) fleet.connect(a, b);
+  }
+  fleet.connect(4, 5);
+  fleet.online[5] = true;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(1, fleet.deliveries);
+  TEST_ASSERT_TRUE(fleet.originAcked);
+}
+
+void test_fleet_two_online_neighbours_deliver_once() {
+  // Node 1's holdoff ends first; node 2 overhears its ACK and stands down
+  SimFleet fleet;
+  fleet.connect(0, 1);
+  fleet.connect(0, 2);
+  fleet.connect(1, 2);
+  fleet.online[1] = true;
+  fleet.online[2] = true;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(1, fleet.deliveries);
+  TEST_ASSERT_TRUE(fleet.originAcked);
+}
+
+void test_fleet_online_neighbours_out_of_earshot_both_deliver() {
+  // Nodes 1 and 2 cannot hear each other's ACK; the server drops the copy
+  SimFleet fleet;
+  fleet.connect(0, 1);
+  fleet.connect(0, 2);
+  fleet.online[1] = true;
+  fleet.online[2] = true;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(2, fleet.deliveries);
+  TEST_ASSERT_TRUE(fleet.originAcked);
+}
+
+void test_fleet_equal_holdoffs_both_deliver() {
+  SimFleet fleet;
+  fleet.connect(0, 1);
+  fleet.connect(0, 2);
+  fleet.connect(1, 2);
+  fleet.online[1] = true;
+  fleet.online[2] = true;
+  fleet.holdoffMs[2] = fleet.holdoffMs[1];
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(2, fleet.deliveries);
+}
+
+void test_fleet_many_online_neighbours_deliver_once() {
+  // Everyone in range of everyone, all online
+  SimFleet fleet;
+  for (int a = 0; a < SIM_NODES; a++) {
+    for (int b = a + 1; b < SIM_NODES; b++) fleet.connect(a, b);
+  }
+  for (int node = 1; node < SIM_NODES; node++) fleet.online[node] = true;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(1, fleet.deliveries);
+  TEST_ASSERT_TRUE(fleet.originAcked);
+}
+
+void test_fleet_origin_retries_until_a_neighbour_is_online() {
+  // Node 1 re-broadcasts the first send into nothing, then gets its uplink back
+  SimFleet fleet;
+  fleet.connect(0, 1);
+  fleet.lateOnline[1] = true;
+  fleet.originRetries = 3;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(2, fleet.originSends);
+  TEST_ASSERT_EQUAL(1, fleet.deliveries);
+  TEST_ASSERT_TRUE(fleet.deliveredRetry);
+  TEST_ASSERT_TRUE(fleet.originAcked);
+}
+
+void test_fleet_origin_stops_retrying_once_acked() {
+  SimFleet fleet;
+  fleet.connect(0, 1);
+  fleet.online[1] = true;
+  fleet.originRetries = 3;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(1, fleet.originSends);
+  TEST_ASSERT_FALSE(fleet.deliveredRetry);
+  TEST_ASSERT_TRUE(fleet.originAcked);
+}
+
+void test_fleet_origin_keeps_retrying_while_isolated() {
+  SimFleet fleet;
+  fleet.connect(0, 1);
+  fleet.originRetries = 3;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(4, fleet.originSends);
+  TEST_ASSERT_EQUAL(0, fleet.deliveries);
+  TEST_ASSERT_FALSE(fleet.originAcked);
+}
+
+void test_fleet_no_bridge_no_neighbour() {
+  // Nothing in range: no ACK ever comes, so the frame stays pending and the
+  // firmware brings its WiFi reconnect forward instead of waiting on ESP-NOW
+  SimFleet fleet;
+  fleet.originRetries = 2;
+  runFleet(fleet);
+  TEST_ASSERT_EQUAL(3, fleet.originSends);
+  TEST_ASSERT_EQUAL(0, fleet.deliveries);
+  TEST_ASSERT_FALSE(fleet.originAcked);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_online_device_delivers_once);
+  RUN_TEST(test_failed_delivery_is_retried);
+  RUN_TEST(test_overheard_ack_cancels_the_holdoff);
+  RUN_TEST(test_ack_for_another_alert_keeps_the_hold);
+  RUN_TEST(test_delivers_at_once_when_no_room_to_hold);
+  RUN_TEST(test_dedup_key_is_device_boot_and_sequence);
+  RUN_TEST(test_offline_device_rebroadcasts_once);
+  RUN_TEST(test_no_rebroadcast_without_radio_channel);
+  RUN_TEST(test_hop_limit);
+  RUN_TEST(test_increment_hops);
+  RUN_TEST(test_ack_forwarded_only_for_own_rebroadcast);
+  RUN_TEST(test_ack_matching);
+  RUN_TEST(test_history_forgets_oldest);
+  RUN_TEST(test_origin_pending_until_acked);
+  RUN_TEST(test_origin_ignores_ack_for_older_press);
+  RUN_TEST(test_origin_retry_backoff);
+  RUN_TEST(test_origin_rejects_non_alert);
+  RUN_TEST(test_fleet_one_hop_to_online_neighbour);
+  RUN_TEST(test_fleet_chain_through_offline_neighbours);
+  RUN_TEST(test_fleet_beyond_hop_limit);
+  RUN_TEST(test_fleet_mesh_loop_is_deduplicated);
+  RUN_TEST(test_fleet_two_online_neighbours_deliver_once);
+  RUN_TEST(test_fleet_online_neighbours_out_of_earshot_both_deliver);
+  RUN_TEST(test_fleet_equal_holdoffs_both_deliver);
+  RUN_TEST(test_fleet_many_online_neighbours_deliver_once);
+  RUN_TEST(test_fleet_origin_retries_until_a_neighbour_is_online);
+  RUN_TEST(test_fleet_origin_stops_retrying_once_acked);
+  RUN_TEST(test_fleet_origin_keeps_retrying_while_isolated);
+  RUN_TEST(test_fleet_no_bridge_no_neighbour);
+  return UNITY_END();
+}